@@ -0,0 +1,80 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  ball_segmentation.h
+\brief Colour segmentation of the ball in camera images: LUT threshold and separable morphology on reused buffers
+\date   October, 2026
+*/
+
+#ifndef _BALL_SEGMENTATION_H_
+#define _BALL_SEGMENTATION_H_
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "calibration_gui/hsv_gate.h"
+#include <string>
+
+/**
+  \class BallSegmenter
+  \brief Binary mask of the ball colour in a BGR image, equivalent to cvtColor(COLOR_BGR2HSV) and inRange followed by a
+  5x5 closing and a 5x5 opening. A hue range wrapping around red (lower hue above the upper one) is the union of two
+  inRange calls, from the lower hue to 179 and from 0 to the upper hue. The HSV threshold is a single lookup per pixel
+  in the table of HSVGate, and the morphology is done with separable min/max filters. The closing and opening are merged into dilate 5, erode 9,
+  dilate 5, since two 5x5 erosions are one 9x9 erosion. Each filter streams through the image a row at a time, the
+  horizontal pass only a few rows ahead of the vertical one, so the rows it works on stay in cache.
+  All buffers are kept between frames.
+  Bayer images can be segmented without demosaicing, each 2x2 quad of the mosaic being one pixel of a half
+  resolution image, with the morphology scaled to half size.
+ */
+class BallSegmenter
+{
+public:
+    BallSegmenter();
+
+    void setRange(int lowH, int highH, int lowS, int highS, int lowV, int highV);
+    const cv::Mat& segment(const cv::Mat& bgr);
+    const cv::Mat& segmentBayer(const cv::Mat& raw, int redX, int redY);
+
+private:
+    void threshold(const cv::Mat& bgr, cv::Mat& mask) const;
+    void thresholdBayer(const cv::Mat& raw, int redX, int redY, cv::Mat& mask) const;
+    void morphology(const cv::Mat& src, cv::Mat& dst, int radius, bool dilate);
+
+    HSVGate gate;   /**< colour lookup table */
+    int range[6];   /**< HSV range of the table */
+    cv::Mat mask;   /**< thresholded image, then the result */
+    cv::Mat work;   /**< intermediate image of the morphology */
+    cv::Mat rows;   /**< horizontal pass of the morphology, a ring of 2*radius+1 rows */
+    cv::Mat quad;   /**< half resolution mask of Bayer images, then the result */
+    cv::Mat quadWork; /**< intermediate half resolution image of the morphology */
+};
+
+bool bayerPattern(const std::string& encoding, int& code, int& redX, int& redY);
+
+void rowMinMax(const uint8_t* src, uint8_t* dst, int width, int radius, bool dilate);
+
+#endif
@@ -0,0 +1,134 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  bounded_queue.h
+\brief Bounded queue between the threads of a detection pipeline
+\date   October, 2026
+*/
+
+#ifndef _BOUNDED_QUEUE_H_
+#define _BOUNDED_QUEUE_H_
+
+#include <deque>
+#include <boost/thread.hpp>
+
+/**
+  \class BoundedQueue
+  \brief Queue of at most capacity items between two pipeline stages. A push never blocks: when the queue is full
+  the oldest item is dropped, so a slow stage skips frames instead of adding latency. A pop blocks until an item
+  arrives or the queue is closed.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity=2) : capacity(capacity>0 ? capacity : 1), closed(false), drops(0) {}
+
+    /**
+    @brief Adds an item, dropping the oldest one if the queue is full
+    @param[in] item item to add
+    @return void
+    */
+    void push(const T& item)
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            if(items.size()>=capacity)
+            {
+                items.pop_front();
+                drops++;
+            }
+            items.push_back(item);
+        }
+        cond.notify_one();
+    }
+
+    /**
+    @brief Takes the oldest item, waiting for one if the queue is empty
+    @param[out] item item taken
+    @return false if the queue was closed and is empty
+    */
+    bool pop(T& item)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        while(items.empty() && !closed)
+            cond.wait(lock);
+        if(items.empty())
+            return false;
+        item=items.front();
+        items.pop_front();
+        return true;
+    }
+
+    /**
+    @brief Takes the oldest item if there is one
+    @param[out] item item taken
+    @return false if the queue is empty
+    */
+    bool tryPop(T& item)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if(items.empty())
+            return false;
+        item=items.front();
+        items.pop_front();
+        return true;
+    }
+
+    /**
+    @brief Wakes up the stage waiting on the queue, which stops once the queue is empty
+    @return void
+    */
+    void close()
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            closed=true;
+        }
+        cond.notify_all();
+    }
+
+    /**
+    @brief Number of items dropped because the queue was full
+    @return unsigned
+    */
+    unsigned dropped()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        return drops;
+    }
+
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<T> items;
+    size_t capacity;  /**< maximum number of items */
+    bool closed;      /**< no more items will be pushed */
+    unsigned drops;   /**< items dropped because the queue was full */
+};
+
+#endif
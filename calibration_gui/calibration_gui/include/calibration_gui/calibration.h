@@ -52,6 +52,7 @@
 #include <geometry_msgs/PointStamped.h>
 #include "tf/tf.h"
 #include <geometry_msgs/Pose.h>
+#include "calibration_gui/SphereDetection.h"
 // To subscribe to image
 #include <cv_bridge/cv_bridge.h>
 #include <image_transport/image_transport.h>
@@ -104,8 +105,11 @@ public:
           allocator_ball_centers.y = -999;
           allocator_ball_centers.z = -999;
           sensors_ball_centers.push_back(allocator_ball_centers);
+          sensors_detections.push_back(calibration_gui::SphereDetection()); // not valid until the first message
 
-          subs.push_back( n_.subscribe <geometry_msgs::PointStamped> (topic_name, 1, boost::bind(&CircleCentroids::sensorUpdate, this, _1, i)) );
+          // The detection carries the same center as SphereCentroid, plus its uncertainty
+          string detection_topic = "/" + sensors_list[i] + "/BD_" + sensors_list[i] + "/SphereDetection";
+          subs.push_back( n_.subscribe <calibration_gui::SphereDetection> (detection_topic, 1, boost::bind(&CircleCentroids::sensorUpdate, this, _1, i)) );
         if (isCamera[i])
           {
             // Allocating space in camImage vector
@@ -133,11 +137,12 @@ public:
     ~CircleCentroids(){}
 
     // Source: https://foundry.supelec.fr/scm/viewvc.php/nouveau/ROS/koala_node/src/camera_position_node.cpp?view=markup&root=rpm_ims&sortdir=down&pathrev=2320
-    void sensorUpdate(const geometry_msgs::PointStampedConstPtr& msg, const int i)
+    void sensorUpdate(const calibration_gui::SphereDetectionConstPtr& msg, const int i)
     {
       sensors_ball_centers[i].x = msg->point.x;
       sensors_ball_centers[i].y = msg->point.y;
       sensors_ball_centers[i].z = msg->point.z;
+      sensors_detections[i] = *msg;
       // cout << "sensor callback: " << i << endl; //DEBUG
     }
 
@@ -166,6 +171,8 @@ public:
 
     vector<pcl::PointXYZ> getSensorsBallCenters (){ return sensors_ball_centers; }
 
+    vector<calibration_gui::SphereDetection> getSensorsDetections (){ return sensors_detections; }
+
     vector<pcl::PointXYZ> getCamCentroidPnP (){ return camCentroidPnP; }
 
     vector<cv::Mat> getCamImage (){ return camImage; }
@@ -175,6 +182,7 @@ public:
 
     vector<ros::Subscriber> subs;
     vector<pcl::PointXYZ> sensors_ball_centers;
+    vector<calibration_gui::SphereDetection> sensors_detections; /**< ball centers with their inliers, residual and covariance. */
 
     vector<ros::Subscriber> subs_pnp;
     vector<pcl::PointXYZ> camCentroidPnP; /**< ball center coordinates on single camera image. */
@@ -191,9 +199,14 @@ void createDirectory ( );
 void writeFile(const Matrix4f transformation, const string filepath);
 void writeFileCamera( cv::Mat transformation, const char* transformation_name, const string filepath);
 void estimateTransformation(geometry_msgs::Pose & laser,pcl::PointCloud<pcl::PointXYZ> target_laserCloud,
-  pcl::PointCloud<pcl::PointXYZ> & laserCloud, const string targetSensorName, const string sensorName);
+  pcl::PointCloud<pcl::PointXYZ> & laserCloud, const string targetSensorName, const string sensorName,
+  const vector<float>& weights = vector<float>());
+Matrix4f weightedRigidTransformation(const pcl::PointCloud<pcl::PointXYZ>& source, const pcl::PointCloud<pcl::PointXYZ>& target,
+  const vector<float>& weights);
+float detectionVariance(const calibration_gui::SphereDetection& detection);
 int estimateTransformationCamera(geometry_msgs::Pose & camera, pcl::PointCloud<pcl::PointXYZ> targetCloud,
-  pcl::PointCloud<pcl::PointXYZ> cameraPnPCloud , const string targetSensorName, const string cameraName, const cv::Mat &projImageconst, bool draw, const bool ransac);
+  pcl::PointCloud<pcl::PointXYZ> cameraPnPCloud , const string targetSensorName, const string cameraName,
+  const cv::Mat &intrinsic_matrix, const cv::Mat &distortion_coeffs, const cv::Mat &projImage, const bool draw, const bool ransac);
 visualization_msgs::Marker addCar(const vector<double>& RPY = vector<double>(), const vector<double>& translation = vector<double>() );
 float pointEuclideanDistance (const pcl::PointXYZ &p1, const pcl::PointXYZ &p2);
 vector<float> gridEuclideanDistance ( const pcl::PointCloud<pcl::PointXYZ>& p1);
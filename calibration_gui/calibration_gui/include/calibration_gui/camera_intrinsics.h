@@ -0,0 +1,78 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  camera_intrinsics.h
+\brief Intrinsic parameters of every camera of the calibration, keyed by sensor namespace
+\date   October, 2026
+*/
+
+#ifndef _CAMERA_INTRINSICS_H_
+#define _CAMERA_INTRINSICS_H_
+
+#include <map>
+#include <string>
+#include "opencv2/core/core.hpp"
+
+/**
+  \class CameraIntrinsics
+  \brief Camera matrix and distortion coefficients of each camera, read once from the intrinsic calibration file.
+  Each camera is an entry of the cameras map, named after the namespace of its nodes (pointgrey_1, pointgrey_2...):
+  \code
+  cameras:
+     pointgrey_1:
+        CM: !!opencv-matrix
+        D: !!opencv-matrix
+  \endcode
+  A camera without an entry can only use the CM1 and D1 matrices at the top level of the file when it is the only camera
+  of the session, since they describe a single camera.
+ */
+class CameraIntrinsics
+{
+public:
+    bool load(const std::string& path);
+    bool get(const std::string& camera, bool useFallback, cv::Mat& cameraMatrix, cv::Mat& distCoeffs) const;
+    bool contains(const std::string& camera) const { return cameras.count(camera)>0; }
+
+private:
+    /**
+      \struct Intrinsics
+      \brief Intrinsic parameters of one camera
+     */
+    struct Intrinsics
+    {
+        cv::Mat cameraMatrix;  /**< 3x3 camera matrix */
+        cv::Mat distCoeffs;    /**< distortion coefficients */
+    };
+
+    std::map<std::string, Intrinsics> cameras;  /**< intrinsics of each camera namespace */
+    Intrinsics fallback;                         /**< CM1 and D1, for a single camera without an entry, empty if there are none */
+};
+
+cv::Mat cameraMatrixForWindow(const cv::Mat& cameraMatrix, int calibrationBinning, int binningX, int binningY,
+                              int offsetX, int offsetY);
+
+#endif
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <string>
 #include "lidar_segmentation/lidar_segmentation.h"
+#include "calibration_gui/sphere_fitting.h"
 
 #if !defined _LDMRS_VISUALIZATION_RVIZ_CPP_
 double BALL_DIAMETER;
@@ -83,5 +84,6 @@ typedef boost::shared_ptr<LidarClusters> LidarClustersPtr;
 
 void circlePoints(vector<ClusterPtr>& circle_points, double radius, double centre[3], int number_points);
 void CalculateCircle(ClusterPtr cluster, double& R, Point& Center);
-void convertDataToXY(sensor_msgs::LaserScan scan, C_DataFromFilePtr& data_gt);
+bool CalculateCircle(ClusterPtr cluster, CircleFit& fit);
+int inscribedAngleStatistics(ClusterPtr cluster, double& mean, double& std);
 #endif
@@ -0,0 +1,80 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  depth_candidates.h
+\brief Ball candidates from the depth of organized point clouds, before any sphere fitting
+\date   October, 2026
+*/
+
+#ifndef _DEPTH_CANDIDATES_H_
+#define _DEPTH_CANDIDATES_H_
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+using namespace std;
+
+/**
+  \class SphereCandidate
+  \brief Blob of an organized cloud whose size matches the ball
+ */
+class SphereCandidate
+{
+public:
+    vector<int> indices; /**< indices of the blob points in the organized cloud */
+    double depth;        /**< mean depth of the blob */
+    double width;        /**< metric extent of the blob along x */
+    double height;       /**< metric extent of the blob along y */
+    double score;        /**< relative size error in relation to the ball, lower is better */
+};
+
+/**
+  \class DepthBlobDetector
+  \brief Connected components of the depth image of an organized cloud (its z channel), split at depth discontinuities.
+  A blob is kept if its metric width and height match the ball diameter. Since the extents are measured on
+  the points themselves, this is the same as comparing the blob size in pixels with the projected ball
+  diameter at the blob depth, without needing the camera intrinsics.
+ */
+class DepthBlobDetector
+{
+public:
+    DepthBlobDetector(double ballDiameter, double discontinuity=0.02, double tolerance=0.35, int minPixels=30);
+
+    void detect(const pcl::PointCloud<pcl::PointXYZ>& cloud, vector<SphereCandidate>& candidates);
+
+private:
+    double diameter;      /**< ball diameter */
+    double discontinuity; /**< depth jump between neighbour pixels that separates blobs, relative to the depth */
+    double tolerance;     /**< relative tolerance on the blob size */
+    int minPixels;        /**< smallest blob considered */
+
+    vector<int> labels;   /**< blob label of each pixel, reused between frames */
+    vector<int> stack;    /**< flood fill stack, reused between frames */
+};
+
+#endif
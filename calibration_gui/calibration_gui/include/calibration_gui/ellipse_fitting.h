@@ -0,0 +1,71 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  ellipse_fitting.h
+\brief Sub-pixel edges and direct least squares ellipse fitting of the ball outline in camera images
+\date   October, 2026
+*/
+
+#ifndef _ELLIPSE_FITTING_H_
+#define _ELLIPSE_FITTING_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+  \class EllipseFit
+  \brief Result of an ellipse fit
+ */
+class EllipseFit
+{
+public:
+    EllipseFit() : x(0), y(0), a(0), b(0), angle(0), residual(0), points(0)
+    {
+        for(int i=0; i<4; i++)
+            for(int j=0; j<4; j++)
+                covariance[i][j]=0;
+    }
+
+    double x;        /**< x coordinate of the ellipse center */
+    double y;        /**< y coordinate of the ellipse center */
+    double a;        /**< semi-major axis */
+    double b;        /**< semi-minor axis */
+    double angle;    /**< angle of the major axis with the x axis [rad] */
+    double residual; /**< weighted RMS algebraic distance of the points, normalized to a distance */
+    size_t points;   /**< number of points used in the fit */
+    double covariance[4][4]; /**< covariance of (x, y, a, b), from the residual and the spread of the points */
+};
+
+bool edgeCrossing(const uint8_t* bgr, size_t step, int width, int height, double x, double y, double nx, double ny,
+                  double halfWidth, double& t, double& contrast);
+bool subpixelEdge(const uint8_t* bgr, size_t bgrStep, const uint8_t* mask, size_t maskStep, int width, int height,
+                  int u, int v, double& x, double& y, double& weight);
+bool fitEllipse(const double* x, const double* y, const double* w, size_t n, EllipseFit& fit);
+bool sphereFromEllipse(const EllipseFit& ellipse, double radius, double center[3]);
+void sphereCovarianceFromEllipse(const EllipseFit& ellipse, double radius, double cov[3][3]);
+
+#endif
@@ -0,0 +1,80 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  frame_budget.h
+\brief Per-frame time budget of the ball detectors, from the sensor rate
+\date   October, 2026
+*/
+
+#ifndef _FRAME_BUDGET_H_
+#define _FRAME_BUDGET_H_
+
+#include "ros/ros.h"
+#include <cstddef>
+#include "calibration_gui/DetectionTiming.h"
+
+/**
+  \class FrameBudget
+  \brief Time budget of a detector for each frame, a fraction of the sensor period.
+  The cost of a RANSAC iteration per point is learned from the previous frames, so the number of iterations
+  granted is what fits in the time left of the frame. When even the minimum number of iterations does not fit,
+  the voxel size of the downsampling grows, and it shrinks back once the frames are well within the budget.
+ */
+class FrameBudget
+{
+public:
+    FrameBudget(double rate=30, double fraction=0.8, int minIterations=100, int maxIterations=10000,
+                double minLeaf=0, double maxLeaf=0);
+
+    void setRate(double rate);
+    void start();
+    int iterations(size_t points);
+    void ransacDone(size_t points, int iterations, double seconds);
+    void finish();
+
+    double budget() const { return limit; }
+    double elapsed() const { return last; }
+    double leafSize() const { return leaf; }
+    calibration_gui::DetectionTiming timing() const;
+
+private:
+    double fraction;    /**< fraction of the sensor period available for a frame */
+    double limit;       /**< time available for a frame [s] */
+    int minIterations;  /**< fewest RANSAC iterations granted */
+    int maxIterations;  /**< most RANSAC iterations granted */
+    double minLeaf;     /**< voxel size when the frames fit in the budget */
+    double maxLeaf;     /**< largest voxel size */
+    double leaf;        /**< current voxel size */
+
+    double cost;        /**< running average of the time of an iteration per point [s], 0 until measured */
+    ros::WallTime begin;/**< start of the current frame */
+    double last;        /**< time taken by the last frame [s] */
+    int granted;        /**< most iterations granted in the current frame */
+    bool starved;       /**< the minimum number of iterations did not fit in the current frame */
+};
+
+#endif
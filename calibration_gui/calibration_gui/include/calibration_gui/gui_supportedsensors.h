@@ -54,7 +54,9 @@ public:
 
     void addTreeChilds(QTreeWidgetItem *parent, const QString sensorID);
 
-    QStringList roslaunchManager(QTreeWidgetItem * item, QString sensor, double ballDiameter);
+    QStringList roslaunchManager(QTreeWidgetItem * item, QString sensor, double ballDiameter, bool singleCamera);
+
+    bool isCameraSensor(QString sensor);
 
     QList<QString> getLaunchedNodes() { return launchedNodes; }
 
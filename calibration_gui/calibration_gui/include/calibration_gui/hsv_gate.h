@@ -0,0 +1,69 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  hsv_gate.h
+\brief Colour gating of XYZRGB clouds by an HSV range, with a precomputed lookup table
+\date   October, 2026
+*/
+
+#ifndef _HSV_GATE_H_
+#define _HSV_GATE_H_
+
+#include <vector>
+#include <stdint.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+using namespace std;
+
+/**
+  \class HSVGate
+  \brief Keeps the points of a cloud whose colour is inside an HSV range, with the OpenCV 8 bit convention
+  (hue 0-179, saturation and value 0-255) used by the Point Grey detector. A lower hue above the upper hue
+  selects a range that wraps around red. The membership of every RGB colour is precomputed in a 2 MB bit table,
+  so the gate costs one lookup per point.
+ */
+class HSVGate
+{
+public:
+    HSVGate(int lowH=142, int highH=179, int lowS=45, int highS=255, int lowV=0, int highV=255);
+
+    void setRange(int lowH, int highH, int lowS, int highS, int lowV, int highV);
+    bool inside(uint8_t r, uint8_t g, uint8_t b) const
+    {
+        uint32_t i=((uint32_t)r<<16)|((uint32_t)g<<8)|b;
+        return lut[i>>3]&(1<<(i&7));
+    }
+    void filter(const pcl::PointCloud<pcl::PointXYZRGB>& cloud, pcl::PointCloud<pcl::PointXYZ>& gated) const;
+
+private:
+    vector<uint8_t> lut; /**< one bit per RGB colour, set if the colour is inside the range */
+};
+
+void rgbToHSV(uint8_t r, uint8_t g, uint8_t b, int& h, int& s, int& v);
+
+#endif
@@ -0,0 +1,64 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  image_roi.h
+\brief Window of camera images around the predicted position of the ball
+\date   October, 2026
+*/
+
+#ifndef _IMAGE_ROI_H_
+#define _IMAGE_ROI_H_
+
+#include "opencv2/core/core.hpp"
+
+/**
+  \class ImageROI
+  \brief Region of interest of camera images, in pixels.
+  The window is the bounding box of the last detected ball, moved by the motion of the ball between the last two
+  detections and enlarged by a margin plus that motion. Until a ball is detected, after it is lost, and every
+  fullInterval frames (to catch a second ball or a wrong track), the full frame is searched.
+ */
+class ImageROI
+{
+public:
+    ImageROI(double margin=0.5, int fullInterval=30);
+
+    void reset();
+    bool tracking() const { return ball.area()>0; }
+
+    cv::Rect window(const cv::Size& image);
+    void update(const cv::Rect& detected);
+
+private:
+    double margin;       /**< margin added to each side of the window, as a fraction of the ball size */
+    int fullInterval;    /**< frames between full frame searches, 0 to only search the full frame when the ball is lost */
+    int frames;          /**< frames since the last full frame search */
+    cv::Rect ball;       /**< bounding box of the last detected ball */
+    cv::Point2d motion;  /**< motion of the ball center between the last two detections */
+};
+
+#endif
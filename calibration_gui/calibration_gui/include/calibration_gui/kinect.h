@@ -59,12 +59,18 @@
 #include <pcl/conversions.h>
 #include <pcl/PCLPointCloud2.h>
 #include <pcl_conversions/pcl_conversions.h>
+#include <pcl_ros/point_cloud.h>
+#include "calibration_gui/SphereDetection.h"
+#include "calibration_gui/hsv_gate.h"
 
 #include <pcl/filters/voxel_grid.h>
 #include <pcl/filters/extract_indices.h>
 
 double BALL_DIAMETER;
 
+#define SPHERE_THRESHOLD 0.0070936 /**< largest distance of a RANSAC inlier to the sphere surface at full resolution [m] */
+#define COARSE_MIN_POINTS 100      /**< smallest coarse grid searched before the fine level, below it only the fine level runs */
+
 using namespace std;
 
 /**
@@ -77,17 +83,24 @@ class kinect
 public:
 	ros::NodeHandle n_;
 	ros::Subscriber pointCloud_subscriber;
-	pcl::PointCloud<pcl::PointXYZ> cloud;
+	pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud; /**< last cloud received, shared with the driver when running in the same process */
+	const HSVGate *gate; /**< colour gate of the cloud, NULL to use all the points */
 
 /**
    @brief Constructor. Subscribes to the point cloud from the Kinect 3D-depth sensor.
    @param nodeToSub node name to subscribe 
+   @param gate colour gate of the cloud, NULL to use all the points
  */
-	kinect(const string &nodeToSub)
+	kinect(const string &nodeToSub, const HSVGate *gate = NULL)
 	{
+		this->gate = gate;
 		//Topics I want to subscribe
-		pointCloud_subscriber=n_.subscribe("/" + nodeToSub + "/camera/depth_registered/points",
-		                                   1, &kinect::pointCloudUpdate, this);
+		if(gate)
+			pointCloud_subscriber=n_.subscribe("/" + nodeToSub + "/camera/depth_registered/points",
+			                                   1, &kinect::colorCloudUpdate, this);
+		else
+			pointCloud_subscriber=n_.subscribe("/" + nodeToSub + "/camera/depth_registered/points",
+			                                   1, &kinect::pointCloudUpdate, this);
 		cout << "/" << nodeToSub << "/camera/depth_registered/points" << endl;
 	}
 	
@@ -101,12 +114,28 @@ public:
    @param msg message received from the Kinect 3D-depth sensor
    @return void
 */
-	void pointCloudUpdate(const sensor_msgs::PointCloud2ConstPtr & msg)
+	void pointCloudUpdate(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr & msg)
 	{
-		pcl::fromROSMsg(*msg, cloud);
+		// pcl_ros deserializes the message straight into the PCL cloud, only the pointer is kept
+		cloud = msg;
 		//ROS_INFO("Scan time: %lf ", msg.data[0]);
 	}
+
+/**
+   @brief Callback function of the coloured cloud, when the colour gate is used. Only the points with the colour
+   of the ball are kept, the others are set to NaN so the cloud stays organized
+   @param msg message received from the Kinect 3D-depth sensor
+   @return void
+*/
+	void colorCloudUpdate(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr & msg)
+	{
+		pcl::PointCloud<pcl::PointXYZ>::Ptr gated (new pcl::PointCloud<pcl::PointXYZ>);
+		gate->filter(*msg, *gated);
+		cloud = gated;
+	}
 };
 
 void writeFile(Eigen::VectorXf sphereCoeffsRefined);
+bool sphereDetection(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &Kinect_cloud, double sphere[4], calibration_gui::SphereDetection &detection);
+void publishDetection(calibration_gui::SphereDetection &detection);
 #endif
@@ -0,0 +1,108 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  laser_conversion.h
+\brief Scan to cartesian conversion shared by the SICK LMS and SICK LD-MRS ball detectors
+\date   October, 2026
+*/
+
+#ifndef _LASER_CONVERSION_H_
+#define _LASER_CONVERSION_H_
+
+#include <vector>
+#include <sensor_msgs/LaserScan.h>
+#include "lidar_segmentation/lidar_segmentation.h"
+
+using namespace std;
+
+/**
+  \class LaserDirectionTable
+  \brief Per-beam direction table of a laser scan layer.
+  The sines and cosines of every beam are computed once for a given scan configuration
+  (angle_min, angle_increment, number of beams and layer rotation) and reused on every sweep,
+  so the conversion to cartesian coordinates is reduced to one multiply per coordinate.
+ */
+class LaserDirectionTable
+{
+public:
+    LaserDirectionTable();
+
+    bool configure(const sensor_msgs::LaserScan& scan, double rot=0);
+    void convert(const sensor_msgs::LaserScan& scan, vector<PointPtr>& points);
+
+    size_t size() const { return dir_x.size(); }
+
+private:
+    double angle_min;       /**< angle_min of the scan the table was built for */
+    double angle_increment; /**< angle_increment of the scan the table was built for */
+    double rotation;        /**< rotation of the scan layer in relation to the XY plane [deg] */
+
+    vector<double> dir_x;   /**< x component of each beam direction */
+    vector<double> dir_y;   /**< y component of each beam direction */
+    double dir_z;           /**< z component, the same for every beam of the layer */
+    double planar;          /**< projection factor of the range on the XY plane */
+    vector<double> theta;   /**< angle of each beam on the XY plane */
+
+    vector<double> x, y, z, range; /**< conversion buffers, reused between sweeps */
+};
+
+/**
+  \class ScanAccumulator
+  \brief Rolling window of the last scans of a static laser.
+  Since the sensor does not move, the scans are registered by beam index and merged as the per-beam
+  mean of the ranges in the window. A beam whose range jumps by more than the tolerance is restarted,
+  so only the beams that hit a stationary target accumulate, and a moving ball falls back to the
+  single scan ranges.
+ */
+class ScanAccumulator
+{
+public:
+    ScanAccumulator(int window=1, double tolerance=0.03);
+
+    void setWindow(int window);
+    int window() const { return W; }
+
+    const sensor_msgs::LaserScan& add(const sensor_msgs::LaserScan& scan);
+
+    /** number of scans merged in the beam, 0 if it had no valid range */
+    int samples(size_t beam) const { return beam<count.size() ? count[beam] : 0; }
+
+private:
+    void reset(size_t beams);
+
+    int W;                  /**< window size [scans] */
+    double tolerance;       /**< range jump that restarts a beam [m] */
+    size_t head;            /**< slot of the window written by the next scan */
+
+    vector<float> history;  /**< last W ranges of each beam, W slots per beam */
+    vector<double> sum;     /**< sum of the ranges in the window of each beam */
+    vector<int> count;      /**< number of ranges in the window of each beam */
+
+    sensor_msgs::LaserScan merged; /**< scan with the per-beam mean ranges */
+};
+
+#endif
@@ -0,0 +1,190 @@
+/**************************************************************************************************
+   Software License Agreement (BSD License)
+
+   Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted
+   provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ * Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+   FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+   IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+   OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************************************/
+/**
+   \file  latency_histogram.h
+   \brief Histograms of the latency of each stage a camera frame goes through, from its exposure to the published result
+   \date   October, 2026
+ */
+
+#ifndef _LATENCY_HISTOGRAM_H_
+#define _LATENCY_HISTOGRAM_H_
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <ros/time.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+/**
+  \class LatencyHistogram
+  \brief Histogram of the latency of one stage, with fixed width bins and a last bin for everything above them.
+  Stages run in their own threads, so adding and reporting are serialised by a mutex.
+ */
+class LatencyHistogram
+{
+public:
+    /**
+    @brief LatencyHistogram constructor
+    @param[in] name name of the stage
+    @param[in] binWidth width of the bins [s]
+    @param[in] bins number of bins before the overflow bin
+    */
+    LatencyHistogram(const std::string& name, double binWidth=0.001, unsigned int bins=200)
+        : name(name), binWidth(binWidth), counts(bins+1, 0)
+    {
+        reset();
+    }
+
+    /**
+    @brief Adds the latency of one frame
+    @param[in] seconds latency [s], negative values (clocks out of step) go to the first bin
+    @return void
+    */
+    void add(double seconds)
+    {
+        seconds=std::max(seconds, 0.0);
+        unsigned int bin=(unsigned int)std::min(seconds/binWidth, counts.size()-1.0);
+
+        boost::mutex::scoped_lock lock(mutex);
+        counts[bin]++;
+        total++;
+        sum+=seconds;
+        largest=std::max(largest, seconds);
+    }
+
+    /**
+    @brief Adds the latency between two instants of one frame
+    @param[in] from start of the stage
+    @param[in] to end of the stage
+    @return void
+    */
+    void add(const ros::Time& from, const ros::Time& to) { add((to-from).toSec()); }
+
+    /**
+    @brief Clears the histogram, to start a new reporting period
+    @return void
+    */
+    void reset()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        std::fill(counts.begin(), counts.end(), 0);
+        total=0;
+        sum=0;
+        largest=0;
+    }
+
+    /**
+    @brief Summary of the latencies added since the last reset, in milliseconds: count, mean, 50th, 90th and 99th
+    percentiles (upper edge of their bin), maximum, and the count of every non empty bin as "upper edge:count"
+    @param[in] hardwareId sensor the stage belongs to
+    @return diagnostic_msgs::DiagnosticStatus status named after the stage, a warning if nothing was added
+    */
+    diagnostic_msgs::DiagnosticStatus status(const std::string& hardwareId) const
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        diagnostic_msgs::DiagnosticStatus status;
+        status.name=name;
+        status.hardware_id=hardwareId;
+        status.level=total ? diagnostic_msgs::DiagnosticStatus::OK : diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message=total ? "latency [ms]" : "no frames";
+
+        addValue(status, "count", total);
+        addValue(status, "mean", total ? 1000*sum/total : 0);
+        addValue(status, "p50", 1000*quantile(0.5));
+        addValue(status, "p90", 1000*quantile(0.9));
+        addValue(status, "p99", 1000*quantile(0.99));
+        addValue(status, "max", 1000*largest);
+
+        std::ostringstream bins;
+        for(unsigned int i=0; i<counts.size(); i++)
+            if(counts[i])
+                bins << (bins.tellp()>0 ? " " : "") << (i+1<counts.size() ? 1000*(i+1)*binWidth : 1000*largest) << ":" << counts[i];
+        addValue(status, "histogram", bins.str());
+        return status;
+    }
+
+private:
+    /**
+    @brief Latency below which a fraction of the frames are, the upper edge of its bin (the maximum in the overflow bin).
+    Called with the mutex locked
+    @param[in] q fraction of the frames
+    @return double latency [s], 0 without frames
+    */
+    double quantile(double q) const
+    {
+        unsigned long rank=(unsigned long)(q*total+0.5), seen=0;
+        for(unsigned int i=0; i<counts.size() && total; i++)
+        {
+            seen+=counts[i];
+            if(seen>=std::max(rank, 1UL))
+                return i+1<counts.size() ? std::min((i+1)*binWidth, largest) : largest;
+        }
+        return 0;
+    }
+
+    template<typename T>
+    static void addValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, const T& value)
+    {
+        std::ostringstream text;
+        text << value;
+        diagnostic_msgs::KeyValue entry;
+        entry.key=key;
+        entry.value=text.str();
+        status.values.push_back(entry);
+    }
+
+    std::string name;                   /**< name of the stage */
+    double binWidth;                    /**< width of the bins [s] */
+    std::vector<unsigned long> counts;  /**< frames in each bin, the last one for those above all bins */
+    unsigned long total;                /**< frames added since the last reset */
+    double sum;                         /**< sum of the latencies added since the last reset [s] */
+    double largest;                     /**< largest latency added since the last reset [s] */
+    mutable boost::mutex mutex;
+};
+
+/**
+   @brief Report of the latency of several stages, after which their histograms are reset so every report covers
+   one period
+   @param[in,out] stages histograms of the stages
+   @param[in] hardwareId sensor the stages belong to
+   @return diagnostic_msgs::DiagnosticArray one status per stage
+ */
+inline diagnostic_msgs::DiagnosticArray LatencyReport(std::vector<LatencyHistogram*>& stages, const std::string& hardwareId)
+{
+    diagnostic_msgs::DiagnosticArray report;
+    report.header.stamp=ros::Time::now();
+    for(unsigned int i=0; i<stages.size(); i++)
+    {
+        report.status.push_back(stages[i]->status(hardwareId));
+        stages[i]->reset();
+    }
+    return report;
+}
+
+#endif
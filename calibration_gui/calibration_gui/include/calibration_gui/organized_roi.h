@@ -0,0 +1,63 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  organized_roi.h
+\brief Pixel window cropping of organized point clouds around the last detected ball
+\date   October, 2026
+*/
+
+#ifndef _ORGANIZED_ROI_H_
+#define _ORGANIZED_ROI_H_
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+/**
+  \class OrganizedROI
+  \brief Region of interest of an organized point cloud (Kinect, SwissRanger), in pixels.
+  The window is the bounding box of the pixels that hit the last detected ball, enlarged by a margin
+  for the motion of the ball between frames. It is found from the organized structure of the cloud,
+  so no camera intrinsics are needed. Until a ball is detected, or after it is lost, the full frame is used.
+ */
+class OrganizedROI
+{
+public:
+    OrganizedROI(double margin=0.5);
+
+    void reset();
+    bool valid() const { return u1>u0 && v1>v0; }
+
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr crop(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr& cloud) const;
+    bool update(const pcl::PointCloud<pcl::PointXYZ>& cloud, const double center[3], double radius);
+
+private:
+    double margin; /**< margin added to each side of the window, as a fraction of the ball size in pixels */
+    int u0, v0;    /**< first column and row of the window */
+    int u1, v1;    /**< one past the last column and row of the window */
+};
+
+#endif
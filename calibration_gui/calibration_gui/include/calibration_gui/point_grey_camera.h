@@ -57,9 +57,21 @@
 #include <pcl/segmentation/sac_segmentation.h>
 #include <visualization_msgs/MarkerArray.h>
 #include "visualization_rviz_swissranger.h"
+#include "calibration_gui/sphere_fitting.h"
+#include "calibration_gui/sphere_detection.h"
+#include "calibration_gui/ball_segmentation.h"
+#include "calibration_gui/ellipse_fitting.h"
+#include "calibration_gui/image_roi.h"
+#include "calibration_gui/bounded_queue.h"
+#include "calibration_gui/camera_intrinsics.h"
+#include "calibration_gui/latency_histogram.h"
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <boost/bind/bind.hpp>
 
 #include <cv_bridge/cv_bridge.h>
 #include <image_transport/image_transport.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <ros/topic.h>
 #include <ros/package.h>
 
 double BALL_DIAMETER;
@@ -67,6 +79,30 @@ double BALL_DIAMETER;
 using namespace cv;
 using namespace std;
 
+/**
+   \struct CameraFrame
+   \brief Image and results of one frame, passed between the stages of the detection pipeline
+ */
+struct CameraFrame
+{
+	ros::Time stamp;                             /**< exposure time of the image, from the message header */
+	ros::Time mark;                              /**< reception of the image, then end of each pipeline stage it goes through */
+	cv_bridge::CvImageConstPtr source;           /**< received image, which may share its data with the message */
+	Mat image;                                   /**< BGR or Bayer image (read only), undistorted unless only the ball contour is undistorted */
+	int bayer;                                   /**< cv::cvtColor code to demosaic the image, -1 if it is BGR */
+	int redX, redY;                              /**< position of the red pixel in the 2x2 quads of a Bayer image */
+	Rect window;                                 /**< searched window of the image */
+	Mat imgColor;                                /**< BGR image of the window (read only) */
+	Mat imgBinary;                               /**< binary image of the window for ball detection */
+	Rect ball;                                   /**< bounding box of the detected ball in the image, empty if none */
+	vector<Point> contour;                       /**< contour of the detected ball in the image */
+	pcl::PointXYZ centroid;                      /**< ball center (x, y) and radius (z) in pixels */
+	pcl::PointXYZ centroidRadius;                /**< ball center in the camera frame */
+	calibration_gui::SphereDetection detection;  /**< ball center in the camera frame, with its uncertainty */
+};
+
+typedef boost::shared_ptr<CameraFrame> CameraFramePtr;
+
 /**
    \class CameraRaw
    \brief Class to subscribe and acquire the images from the Point Grey camera
@@ -77,46 +113,79 @@ class CameraRaw
 public:
 	ros::NodeHandle n_;
 	image_transport::Subscriber subs_cam_image;
-	Mat camImage;
+	BoundedQueue<CameraFramePtr> &frames;
+	bool bayerInput;
+	LatencyHistogram &latency;
 
 /**
 	@brief Constructor. Subscription to the topic that contains the images acquired from the Point Grey camera.
 	@param nodeToSub node name to subscribe
+	@param frames queue of the first stage of the detection pipeline
+	@param bayerInput true to subscribe to the mosaic published by the driver and keep it in Bayer, false to subscribe
+	to the BGR images
+	@param latency histogram of the time from the stamp of the images to their reception
 */
-	CameraRaw(const string &nodeToSub)
+	CameraRaw(const string &nodeToSub, BoundedQueue<CameraFramePtr> &frames, bool bayerInput, LatencyHistogram &latency)
+		: frames(frames), bayerInput(bayerInput), latency(latency)
 	{
 		image_transport::ImageTransport it(n_);
-		subs_cam_image = it.subscribe ("/" + nodeToSub + "/RawImage", 1, &CameraRaw::imageUpdate, this);
+		subs_cam_image = it.subscribe ("/" + nodeToSub + (bayerInput ? "/image_raw" : "/RawImage"), 1, &CameraRaw::imageUpdate, this);
 	}
 
 /**
-   @brief Callback function that is called when a message arrives to the topic: "/" + nodeToSub + "/RawImage"
-   @param msg message received from the SICK LD-MRS laser sensor
+   @brief Callback function that is called when a message arrives to the topic: "/" + nodeToSub + "/RawImage", or
+   "/" + nodeToSub + "/image_raw" for Bayer input.
+   The image is queued for the detection pipeline, shared with the message if it is already BGR or is kept in Bayer
+   @param msg message received from the Point Grey camera
    @return void
 */
 	void imageUpdate(const sensor_msgs::ImageConstPtr& msg)
 	{
+		CameraFramePtr frame(new CameraFrame);
+		frame->mark = ros::Time::now();
+		frame->bayer = -1;
 		try
 		{
-			camImage = cv_bridge::toCvCopy(msg, sensor_msgs::image_encodings::BGR8)->image;
+			if(bayerInput && bayerPattern(msg->encoding, frame->bayer, frame->redX, frame->redY))
+				frame->source = cv_bridge::toCvShare(msg);
+			else
+				frame->source = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::BGR8);
+			frame->image = frame->source->image;
 		}
 		catch (cv_bridge::Exception &e)
 		{
 			ROS_ERROR("cv_bridge exception: %s", e.what());
+			return;
 		}
-		//ROS_INFO("Scan time: %lf ", msg.ranges[1]);
+		frame->stamp = msg->header.stamp.isZero() ? frame->mark : msg->header.stamp;
+		latency.add(frame->stamp, frame->mark);
+		frames.push(frame);
 	}
 };
 
 void CreateTrackbarsAndWindows ();
 
-void ImageProcessing(Mat &img);
+void UpdateTunables(ros::NodeHandle &n, bool readParams);
+
+void ImageProcessing(CameraFrame &frame);
+
+void BayerImageProcessing(CameraFrame &frame, const int range[6]);
 
 void HoughDetection(const Mat &img, const Mat& imgBinary );
 
-void PolygonalCurveDetection( Mat &img, Mat &imgBinary );
+void SubpixelEdges( const CameraFrame &frame, const vector<Point> &contour, vector<Point2f> &edges, vector<double> &weights );
+
+void UndistortContour( const vector<Point2f> &points, vector<Point2f> &undistorted );
+
+void PolygonalCurveDetection( CameraFrame &frame );
+
+void PublishFrame( CameraFrame &frame );
+
+void PipelineStage( void (*process)(CameraFrame&), BoundedQueue<CameraFramePtr> *in, BoundedQueue<CameraFramePtr> *out,
+                    LatencyHistogram *latency );
+
+void CentroidPub( const pcl::PointXYZ centroid, const pcl::PointXYZ centroidRadius, calibration_gui::SphereDetection &detection, const ros::Time &stamp );
 
-void CentroidPub( const pcl::PointXYZ centroid, const pcl::PointXYZ centroidRadius );
 
 void setLabel(cv::Mat& im, const std::string label, std::vector<cv::Point>& contour);
 
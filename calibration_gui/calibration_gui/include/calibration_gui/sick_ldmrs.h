@@ -54,6 +54,8 @@
 #include <ros/package.h>
 #include <sensor_msgs/LaserScan.h>
 #include "lidar_segmentation/lidar_segmentation.h"
+#include "calibration_gui/sphere_fitting.h"
+#include "calibration_gui/SphereDetection.h"
 
 using namespace std;
 
@@ -148,8 +150,8 @@ public:
     }
 };
 
-double find_circle(vector<ClusterPtr> clusters, vector<ClusterPtr>& circleP, int layer);
-void calculateSphereCentroid(vector<geometry_msgs::Point> center, geometry_msgs::PointStamped &sphereCentroid, vector<double> radius);
+double find_circle(vector<ClusterPtr> clusters, vector<ClusterPtr>& circleP, int layer, CircleFit& fit);
+void calculateSphereCentroid(vector<geometry_msgs::Point> center, geometry_msgs::PointStamped &sphereCentroid, vector<double> radius,
+                             const vector<CircleFit>& fits, calibration_gui::SphereDetection& detection);
 void rotatePoints(double& x,double& y, double& z, double angle);
-void convertDataToXYZ(sensor_msgs::LaserScan scan, vector<C_DataFromFilePtr>& data_gt, double rot);
 #endif
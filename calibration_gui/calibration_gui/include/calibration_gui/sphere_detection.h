@@ -0,0 +1,50 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  sphere_detection.h
+\brief Helpers to fill the SphereDetection message published by the ball detectors
+\date   October, 2026
+*/
+
+#ifndef _SPHERE_DETECTION_H_
+#define _SPHERE_DETECTION_H_
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <geometry_msgs/PointStamped.h>
+#include "calibration_gui/SphereDetection.h"
+
+using namespace std;
+
+void invalidDetection(calibration_gui::SphereDetection& detection);
+void setDetectionCovariance(calibration_gui::SphereDetection& detection, const double cov[3][3]);
+void sphereDetectionFromInliers(const pcl::PointCloud<pcl::PointXYZ>& cloud, const vector<int>& indices,
+                                const double center[3], double radius, calibration_gui::SphereDetection& detection);
+geometry_msgs::PointStamped detectionCentroid(const calibration_gui::SphereDetection& detection);
+
+#endif
@@ -0,0 +1,98 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  sphere_fitting.h
+\brief Algebraic circle and sphere fitting shared by the ball detectors
+\date   October, 2026
+*/
+
+#ifndef _SPHERE_FITTING_H_
+#define _SPHERE_FITTING_H_
+
+#include <cstddef>
+
+/**
+  \class CircleMoments
+  \brief Fixed-size accumulator of the planar moments (up to 4th order) of a set of points.
+  Moments are accumulated around a fixed origin, which should be close to the points (e.g. their first point)
+  to keep the sums well conditioned. Accumulators built around the same origin can be merged, so a point set
+  can be split between threads and the partial moments summed afterwards.
+ */
+class CircleMoments
+{
+public:
+    CircleMoments(double x0=0, double y0=0);
+
+    void clear();
+    void add(double x, double y);
+    void add(const double* x, const double* y, size_t n);
+    CircleMoments& operator+=(const CircleMoments& other);
+
+    size_t count() const { return (size_t)S[0][0]; }
+    double originX() const { return origin[0]; }
+    double originY() const { return origin[1]; }
+
+    void centralMoments(double& mean_x, double& mean_y, double M[5][5]) const;
+
+private:
+    double origin[2];
+    double S[5][5]; /**< S[p][q] = sum of u^p*v^q, with (u,v) relative to the origin and p+q<=4 */
+};
+
+/**
+  \class CircleFit
+  \brief Result of a circle fit
+ */
+class CircleFit
+{
+public:
+    CircleFit() : x(0), y(0), radius(0), residual(0), points(0)
+    {
+        for(int i=0; i<3; i++)
+            for(int j=0; j<3; j++)
+                covariance[i][j]=0;
+    }
+
+    double x;        /**< x coordinate of the circle center */
+    double y;        /**< y coordinate of the circle center */
+    double radius;   /**< circle radius */
+    double residual; /**< RMS distance of the points to the circle (first order approximation) */
+    size_t points;   /**< number of points used in the fit */
+    double covariance[3][3]; /**< covariance of (x, y, radius), from the residual and the geometry of the arc */
+};
+
+bool fitCircleKasa(const CircleMoments& moments, CircleFit& fit);
+bool fitCircleTaubin(const CircleMoments& moments, CircleFit& fit);
+double sphereOffsetFromCircle(double circleRadius, double sphereRadius);
+void sphereCovarianceFromCircle(const CircleFit& circle, double sphereRadius, double cov[3][3]);
+bool sphereCovariance(const double* x, const double* y, const double* z, size_t n, const double center[3], double radius,
+                      double& residual, double cov[3][3]);
+bool fitSphere(const double* x, const double* y, const double* z, size_t n, double center[3], double& radius);
+bool fitSphereKnownRadius(const double* x, const double* y, const double* z, size_t n, double radius,
+                          double center[3], int iterations=10);
+
+#endif
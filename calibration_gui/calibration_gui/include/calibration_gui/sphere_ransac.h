@@ -0,0 +1,127 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+\file  sphere_ransac.h
+\brief RANSAC sphere detection with the known radius of the ball
+\date   October, 2026
+*/
+
+#ifndef _SPHERE_RANSAC_H_
+#define _SPHERE_RANSAC_H_
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <boost/thread.hpp>
+
+#define RANSAC_BATCH 16     /**< samples drawn with the same generator, the unit of work of the threads */
+#define RANSAC_ROUND 0.001  /**< time of a round of the thread pool [s], long enough to hide waking the workers */
+
+using namespace std;
+
+/**
+  \class SphereRansac
+  \brief RANSAC of a sphere of known radius, for clouds in the frame of the sensor.
+  With the radius known, 3 points are a minimal sample: the center lies on the axis of their circumcircle,
+  on the side away from the sensor for a visible cap, so each sample gives a single hypothesis. The number of
+  iterations adapts to the best inlier ratio found so far. The points are kept as separate x, y and z float
+  arrays, so the inlier test (a squared distance between two bounds, without sqrt) is vectorized 8 points
+  at a time when built with AVX. Batches of samples are scored in parallel by a pool of threads that lives as long
+  as the object, in rounds of the same number of consecutive batches per thread, sized to last about RANSAC_ROUND.
+  The results of a round are merged in batch order, stopping at the first batch a single thread would not have
+  drawn, so the detection depends neither on the number of threads nor on the size of the rounds.
+ */
+class SphereRansac
+{
+public:
+    SphereRansac(double radius, double threshold=0.0070936, int maxIterations=10000, double probability=0.99);
+    ~SphereRansac();
+
+    void setRadius(double radius) { this->radius=radius; }
+    void setThreads(int threads);
+    void setMaxIterations(int maxIterations) { this->maxIterations=maxIterations; }
+    void setThreshold(double threshold) { this->threshold=threshold; }
+    void setInputCloud(const pcl::PointCloud<pcl::PointXYZ>& cloud);
+    bool segment(double sphere[4], vector<int>& inliers);
+
+    int hypotheses() const { return lastHypotheses; }
+    int iterations() const { return nextBatch*RANSAC_BATCH; }
+
+private:
+    /**
+      \struct BatchResult
+      \brief Best model of one batch of samples
+     */
+    struct BatchResult
+    {
+        size_t inliers;   /**< inliers of the best model of the batch */
+        float center[3];  /**< center of the best model of the batch */
+        int hypotheses;   /**< hypotheses scored in the batch */
+    };
+
+    bool hypothesis(unsigned& state, float center[3]) const;
+    size_t countInliers(const float center[3]) const;
+    void selectInliers(const float center[3], vector<int>& inliers, vector<double>& ix, vector<double>& iy,
+                       vector<double>& iz) const;
+    void evaluate(int batch, BatchResult& result) const;
+    void worker(int slot, int generation);
+    void startPool();
+    void stopPool();
+
+    double radius;     /**< known radius of the ball */
+    double threshold;  /**< largest distance of an inlier to the sphere surface */
+    int maxIterations; /**< largest number of samples drawn */
+    double probability;/**< probability of drawing at least one sample free of outliers */
+    unsigned seed;     /**< seed of the xorshift generators of the sample batches */
+    int threads;       /**< threads scoring hypotheses, the caller of segment and threads-1 workers */
+    int lastHypotheses;/**< hypotheses scored by the last call to segment */
+
+    vector<float> x, y, z; /**< finite points of the cloud, padded with NaN to a multiple of 8 */
+    vector<int> indices;   /**< index in the input cloud of each point */
+    size_t n;              /**< number of points, without the padding */
+
+    int nextBatch;         /**< batches merged so far */
+    double required;       /**< samples needed for the best model so far */
+    size_t best;           /**< inliers of the best model so far */
+    float bestCenter[3];   /**< center of the best model so far */
+
+    boost::thread_group* pool;       /**< workers, NULL with a single thread */
+    boost::mutex mutex;              /**< guards the round state below */
+    boost::condition_variable work;  /**< signals the workers a new round or the end of the pool */
+    boost::condition_variable done;  /**< signals segment that the workers finished the round */
+    int generation;                  /**< number of rounds started */
+    int roundStart;                  /**< first batch of the current round */
+    int roundBatches;                /**< batches of each thread in the current round */
+    int pending;                     /**< workers still running the current round */
+    bool stopping;                   /**< true to end the workers */
+    vector<BatchResult> results;     /**< result of each batch of the current round, from roundStart */
+};
+
+void sphereShell(const pcl::PointCloud<pcl::PointXYZ>& cloud, const double center[3], double radius, double margin,
+                 pcl::PointCloud<pcl::PointXYZ>& shell);
+
+#endif
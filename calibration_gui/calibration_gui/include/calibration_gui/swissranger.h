@@ -34,6 +34,11 @@
 #define _SWISSRANGER_H_
 
 #include <eigen3/Eigen/Dense>
+#include <cstring>
+#include <limits>
+#include <sensor_msgs/PointCloud2.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
 
 double BALL_DIAMETER;
 
@@ -49,16 +54,28 @@ class swissranger
 public:
     ros::NodeHandle n_;
     ros::Subscriber pointCloud_subscriber;
-    sensor_msgs::PointCloud cloud; /**< point cloud from the swissranger. */
+    sensor_msgs::PointCloud2ConstPtr msg;     /**< last message received, kept for republishing */
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;/**< organized point cloud from the swissranger, NaN on invalid pixels. Reused between messages */
+    unsigned frames;                          /**< number of clouds received */
+    size_t rejected;                          /**< pixels of the last cloud dropped for low confidence or amplitude */
+    float minConfidence;                      /**< confidence below which a pixel is dropped, raw 16 bit value of the driver */
+    float minAmplitude;                       /**< amplitude below which a pixel is dropped, raw 16 bit value of the driver */
 
 /**
-	@brief Constructor. Subscription of the point cloud from the swissranger
+	@brief Constructor. Subscription of the organized point cloud from the swissranger
 	@param nodeToSub node name to subscribe
+	@param minConfidence confidence below which a pixel is dropped, 0 to keep all
+	@param minAmplitude amplitude below which a pixel is dropped, 0 to keep all
 */
-    swissranger(const string &nodeToSub)
+    swissranger(const string &nodeToSub, double minConfidence=0, double minAmplitude=0)
     {
+        frames=0;
+        rejected=0;
+        this->minConfidence=minConfidence;
+        this->minAmplitude=minAmplitude;
+        cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
         //Topics I want to subscribe
-        pointCloud_subscriber=n_.subscribe("/" + nodeToSub + "/pointcloud_raw", 1, &swissranger::pointCloudUpdate, this);
+        pointCloud_subscriber=n_.subscribe("/" + nodeToSub + "/pointcloud2_raw", 1, &swissranger::pointCloudUpdate, this);
     }
 
 /**
@@ -67,14 +84,71 @@ public:
     ~swissranger(){}
 
 /**
-   @brief Callback function that is called when a message arrives
+   @brief Callback function that is called when a message arrives. The x, y and z fields are copied into the
+   cloud, which is only reallocated if the image size changes. Pixels with low confidence (flying pixels at the
+   object edges, multipath) or low amplitude (dark or distant surfaces) are set to NaN, so the cloud stays organized
    @param msg message received from the Swissranger sensor
    @return void
  */
-    void pointCloudUpdate(const sensor_msgs::PointCloud & msg)
+    void pointCloudUpdate(const sensor_msgs::PointCloud2ConstPtr & msg)
     {
-        cloud=msg;
-        //ROS_INFO("Scan time: %lf ", msg.data[0]);
+        int offset[3]={-1, -1, -1}, amplitude=-1, confidence=-1;
+        for(size_t f=0; f<msg->fields.size(); f++)
+        {
+            const sensor_msgs::PointField& field=msg->fields[f];
+            if(field.datatype!=sensor_msgs::PointField::FLOAT32)
+                continue;
+            if(field.name=="x")
+                offset[0]=field.offset;
+            else if(field.name=="y")
+                offset[1]=field.offset;
+            else if(field.name=="z")
+                offset[2]=field.offset;
+            else if(field.name=="intensity")
+                amplitude=field.offset;
+            else if(field.name=="confidence")
+                confidence=field.offset;
+        }
+        if(offset[0]<0 || offset[1]<0 || offset[2]<0)
+        {
+            ROS_WARN_THROTTLE(5, "pointcloud2_raw without float x, y and z fields");
+            return;
+        }
+
+        // a threshold is only applied if the driver publishes its field
+        float minC= confidence>=0 ? minConfidence : 0, minA= amplitude>=0 ? minAmplitude : 0;
+        if(confidence<0)
+            confidence=offset[0];
+        if(amplitude<0)
+            amplitude=offset[0];
+
+        this->msg=msg;
+        rejected=0;
+        cloud->width=msg->width;
+        cloud->height=msg->height;
+        cloud->is_dense=false;
+        cloud->points.resize((size_t)msg->width*msg->height);
+        for(size_t r=0; r<msg->height; r++)
+        {
+            const uint8_t* data=&msg->data[r*msg->row_step];
+            pcl::PointXYZ* p=&cloud->points[r*msg->width];
+            for(size_t c=0; c<msg->width; c++, data+=msg->point_step, p++)
+            {
+                memcpy(&p->x, data+offset[0], sizeof(float));
+                memcpy(&p->y, data+offset[1], sizeof(float));
+                memcpy(&p->z, data+offset[2], sizeof(float));
+
+                float c, a;
+                memcpy(&c, data+confidence, sizeof(float));
+                memcpy(&a, data+amplitude, sizeof(float));
+                if(c<minC || a<minA)
+                {
+                    p->x=p->y=p->z=numeric_limits<float>::quiet_NaN();
+                    rejected++;
+                }
+            }
+        }
+        frames++;
     }
 };
 
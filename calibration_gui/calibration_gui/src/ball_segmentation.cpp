@@ -0,0 +1,252 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  ball_segmentation.cpp
+ \brief Colour segmentation of the ball in camera images: LUT threshold and separable morphology on reused buffers
+ \date   October, 2026
+*/
+
+#include "calibration_gui/ball_segmentation.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+@brief BallSegmenter constructor, with the default HSV range of the Point Grey detector
+*/
+BallSegmenter::BallSegmenter()
+{
+    range[0]=142;
+    range[1]=179;
+    range[2]=45;
+    range[3]=255;
+    range[4]=0;
+    range[5]=255;
+}
+
+/**
+@brief Sets the HSV range. The lookup table is only rebuilt when the range changes (e.g. from the trackbars)
+@param[in] lowH lower hue
+@param[in] highH upper hue
+@param[in] lowS lower saturation
+@param[in] highS upper saturation
+@param[in] lowV lower value
+@param[in] highV upper value
+@return void
+*/
+void BallSegmenter::setRange(int lowH, int highH, int lowS, int highS, int lowV, int highV)
+{
+    int r[6]={lowH, highH, lowS, highS, lowV, highV};
+    if(std::equal(r, r+6, range))
+        return;
+    std::copy(r, r+6, range);
+    gate.setRange(lowH, highH, lowS, highS, lowV, highV);
+}
+
+/**
+@brief Binary mask of the ball colour
+@param[in] bgr 8 bit BGR image
+@return mask (0 or 255), valid until the next call
+*/
+const cv::Mat& BallSegmenter::segment(const cv::Mat& bgr)
+{
+    threshold(bgr, mask);
+    morphology(mask, work, 2, true);   // closing
+    morphology(work, mask, 4, false);  // closing and opening
+    morphology(mask, work, 2, true);   // opening
+    std::swap(mask, work);
+    return mask;
+}
+
+/**
+@brief Binary mask of the ball colour in a Bayer image, at half resolution: each 2x2 quad of the mosaic is one RGB
+pixel (the mean of its two greens) and the closing and opening are 3x3
+@param[in] raw 8 bit Bayer image (or a window of it starting on a quad)
+@param[in] redX column of the red pixel in a quad
+@param[in] redY row of the red pixel in a quad
+@return mask of (raw.cols/2)x(raw.rows/2) pixels (0 or 255), valid until the next call
+*/
+const cv::Mat& BallSegmenter::segmentBayer(const cv::Mat& raw, int redX, int redY)
+{
+    thresholdBayer(raw, redX, redY, quad);
+    morphology(quad, quadWork, 1, true);
+    morphology(quadWork, quad, 2, false);
+    morphology(quad, quadWork, 1, true);
+    std::swap(quad, quadWork);
+    return quad;
+}
+
+/**
+@brief HSV threshold of a BGR image through the lookup table
+@param[in] bgr 8 bit BGR image
+@param[out] mask 255 where the colour is inside the range, 0 elsewhere
+@return void
+*/
+void BallSegmenter::threshold(const cv::Mat& bgr, cv::Mat& mask) const
+{
+    mask.create(bgr.size(), CV_8UC1);
+    for(int y=0; y<bgr.rows; y++)
+    {
+        const uint8_t* p=bgr.ptr<uint8_t>(y);
+        uint8_t* m=mask.ptr<uint8_t>(y);
+        for(int x=0; x<bgr.cols; x++, p+=3)
+            m[x]= gate.inside(p[2], p[1], p[0]) ? 255 : 0;
+    }
+}
+
+/**
+@brief HSV threshold of the 2x2 quads of a Bayer image through the lookup table
+@param[in] raw 8 bit Bayer image
+@param[in] redX column of the red pixel in a quad
+@param[in] redY row of the red pixel in a quad
+@param[out] mask half resolution mask, 255 where the colour is inside the range, 0 elsewhere
+@return void
+*/
+void BallSegmenter::thresholdBayer(const cv::Mat& raw, int redX, int redY, cv::Mat& mask) const
+{
+    mask.create(raw.rows/2, raw.cols/2, CV_8UC1);
+    int blueX=1-redX;
+    for(int y=0; y<mask.rows; y++)
+    {
+        const uint8_t* red=raw.ptr<uint8_t>(2*y+redY);
+        const uint8_t* blue=raw.ptr<uint8_t>(2*y+1-redY);
+        uint8_t* m=mask.ptr<uint8_t>(y);
+        for(int x=0; x<mask.cols; x++)
+        {
+            int g=(red[2*x+blueX]+blue[2*x+redX]+1)>>1;
+            m[x]= gate.inside(red[2*x+redX], g, blue[2*x+blueX]) ? 255 : 0;
+        }
+    }
+}
+
+/**
+@brief Bayer pattern of a ROS image encoding
+@param[in] encoding image encoding (sensor_msgs::image_encodings)
+@param[out] code cv::cvtColor code to demosaic the image to BGR
+@param[out] redX column of the red pixel in a 2x2 quad
+@param[out] redY row of the red pixel in a 2x2 quad
+@return false if the encoding is not an 8 bit Bayer pattern
+*/
+bool bayerPattern(const std::string& encoding, int& code, int& redX, int& redY)
+{
+    // OpenCV names the patterns by the second row, as cv_bridge does
+    if(encoding=="bayer_rggb8")
+    {
+        code=cv::COLOR_BayerBG2BGR; redX=0; redY=0;
+    }
+    else if(encoding=="bayer_grbg8")
+    {
+        code=cv::COLOR_BayerGB2BGR; redX=1; redY=0;
+    }
+    else if(encoding=="bayer_gbrg8")
+    {
+        code=cv::COLOR_BayerGR2BGR; redX=0; redY=1;
+    }
+    else if(encoding=="bayer_bggr8")
+    {
+        code=cv::COLOR_BayerRG2BGR; redX=1; redY=1;
+    }
+    else
+        return false;
+    return true;
+}
+
+/**
+@brief Combines two rows of a binary mask (0 or 255), where the maximum is an or and the minimum an and, eight pixels
+at a time
+@param[in,out] dst row, replaced by the maximum or minimum
+@param[in] src other row
+@param[in] width number of pixels
+@param[in] dilate true for the maximum, false for the minimum
+@return void
+*/
+static void combineRows(uint8_t* dst, const uint8_t* src, int width, bool dilate)
+{
+    int x=0;
+    for(; x+8<=width; x+=8)
+    {
+        uint64_t a, b;
+        memcpy(&a, dst+x, 8);
+        memcpy(&b, src+x, 8);
+        a= dilate ? a|b : a&b;
+        memcpy(dst+x, &a, 8);
+    }
+    for(; x<width; x++)
+        dst[x]= dilate ? dst[x]|src[x] : dst[x]&src[x];
+}
+
+/**
+@brief Maximum (dilation) or minimum (erosion) of a binary mask row over a window, as the combination of the row
+shifted by -radius to radius. The pixels outside the row are ignored, as with the default border of cv::dilate
+and cv::erode
+@param[in] src source row
+@param[out] dst filtered row, not src
+@param[in] width row width
+@param[in] radius half size of the window
+@param[in] dilate true for the maximum, false for the minimum
+@return void
+*/
+void rowMinMax(const uint8_t* src, uint8_t* dst, int width, int radius, bool dilate)
+{
+    memcpy(dst, src, width);
+    for(int k=1; k<=radius && k<width; k++)
+    {
+        combineRows(dst, src+k, width-k, dilate);
+        combineRows(dst+k, src, width-k, dilate);
+    }
+}
+
+/**
+@brief Dilation or erosion of a binary mask by a square, as a horizontal pass followed by a vertical pass. Each row of the horizontal
+pass is computed just before the vertical pass needs it, into a ring of 2*radius+1 rows
+@param[in] src binary mask (0 or 255)
+@param[out] dst filtered image, not src
+@param[in] radius half size of the square
+@param[in] dilate true for a dilation, false for an erosion
+@return void
+*/
+void BallSegmenter::morphology(const cv::Mat& src, cv::Mat& dst, int radius, bool dilate)
+{
+    int width=src.cols, height=src.rows, ring=2*radius+1;
+    dst.create(src.size(), CV_8UC1);
+    rows.create(ring, width, CV_8UC1);
+
+    for(int y=0; y<height+radius; y++)
+    {
+        if(y<height)
+            rowMinMax(src.ptr<uint8_t>(y), rows.ptr<uint8_t>(y%ring), width, radius, dilate);
+
+        int out=y-radius;
+        if(out<0)
+            continue;
+
+        int y0=std::max(out-radius, 0), y1=std::min(out+radius, height-1);
+        uint8_t* d=dst.ptr<uint8_t>(out);
+        memcpy(d, rows.ptr<uint8_t>(y0%ring), width);
+        for(int k=y0+1; k<=y1; k++)
+            combineRows(d, rows.ptr<uint8_t>(k%ring), width, dilate);
+    }
+}
@@ -0,0 +1,114 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  ball_segmentation_benchmark.cpp
+ \brief Comparison of the ball colour segmentation with the OpenCV chain of the Point Grey detector on recorded images
+ \date   October, 2026
+ */
+
+#include "ros/ros.h"
+#include "calibration_gui/ball_segmentation.h"
+#include "opencv2/core/core.hpp"
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+using namespace cv;
+
+/**
+   @brief cvtColor, inRange, closing and opening, as in the Point Grey detector
+   @param[in] img BGR image
+   @param[out] imgHSV HSV image
+   @param[out] imgBinary mask
+   @return void
+ */
+void openCVSegmentation(const Mat &img, Mat &imgHSV, Mat &imgBinary)
+{
+	Mat element = getStructuringElement(MORPH_RECT, Size(5, 5));
+
+	cvtColor(img, imgHSV, COLOR_BGR2HSV);
+	inRange(imgHSV, Scalar(142, 45, 0), Scalar(179, 255, 255), imgBinary);
+
+	dilate(imgBinary, imgBinary, element);
+	erode(imgBinary, imgBinary, element);
+
+	erode(imgBinary, imgBinary, element);
+	dilate(imgBinary, imgBinary, element);
+}
+
+/**
+   @brief Runs both segmentations on each image, with the default HSV range of the detector, and counts the pixels
+   where the masks differ
+   @param argc
+   @param argv repetitions and the image files
+   @return int
+ */
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		cout << "Usage: ball_segmentation_benchmark <repetitions> <image>..." << endl;
+		return 1;
+	}
+
+	int repetitions = max(atoi(argv[1]), 1);
+	BallSegmenter segmenter;
+
+	printf("%-30s %10s | %10s %10s | %10s %10s | %10s %10s\n", "image", "pixels",
+		   "opencv ms", "Mpix/s", "fused ms", "Mpix/s", "mask", "differ");
+
+	for(int i = 2; i < argc; i++)
+	{
+		Mat img = imread(argv[i], CV_LOAD_IMAGE_COLOR);
+		if(img.empty())
+		{
+			cout << "Could not read " << argv[i] << endl;
+			continue;
+		}
+
+		Mat imgHSV, reference;
+		ros::WallTime start = ros::WallTime::now();
+		for(int r = 0; r < repetitions; r++)
+			openCVSegmentation(img, imgHSV, reference);
+		double openCVTime = (ros::WallTime::now() - start).toSec()/repetitions;
+
+		Mat mask;
+		start = ros::WallTime::now();
+		for(int r = 0; r < repetitions; r++)
+			mask = segmenter.segment(img);
+		double fusedTime = (ros::WallTime::now() - start).toSec()/repetitions;
+
+		double pixels = img.total();
+		printf("%-30s %10.0f | %10.3f %10.1f | %10.3f %10.1f | %10d %10d\n", argv[i], pixels,
+			   openCVTime*1000, pixels/openCVTime/1e6, fusedTime*1000, pixels/fusedTime/1e6,
+			   countNonZero(mask), countNonZero(mask != reference));
+	}
+
+	return 0;
+}
@@ -112,15 +112,20 @@ void writeFileCamera( cv::Mat transformation, const char* transformation_name, c
    @param[out] laserCloud point cloud from the source sensor
    @param[in] targetSensorName name of the reference sensor
    @param[in] sensorName name of the source sensor
+   @param[in] weights weight of each pair of points. If empty, all pairs have the same weight
    @return void
  */
 void estimateTransformation(geometry_msgs::Pose & laser,pcl::PointCloud<pcl::PointXYZ> target_laserCloud,
-	pcl::PointCloud<pcl::PointXYZ> & laserCloud, const string targetSensorName, const string sensorName)
+	pcl::PointCloud<pcl::PointXYZ> & laserCloud, const string targetSensorName, const string sensorName,
+	const vector<float>& weights)
 {
 	//Eigen::Matrix4d transformation of laser lms151 to ldmrs
 	pcl::registration::TransformationEstimationSVD<pcl::PointXYZ,pcl::PointXYZ> TESVD;
 	pcl::registration::TransformationEstimationSVD<pcl::PointXYZ,pcl::PointXYZ>::Matrix4 transformation;
-	TESVD.estimateRigidTransformation (laserCloud,target_laserCloud,transformation);
+	if (weights.size() == laserCloud.points.size())
+		transformation = weightedRigidTransformation(laserCloud, target_laserCloud, weights);
+	else
+		TESVD.estimateRigidTransformation (laserCloud,target_laserCloud,transformation);
 	cout<<transformation<<endl;
 
 	Matrix4f Trans;
@@ -172,6 +177,65 @@ void estimateTransformation(geometry_msgs::Pose & laser,pcl::PointCloud<pcl::Poi
 	writeFile(Trans, FilePath);
 }
 
+/**
+   @brief Weighted least squares rigid transformation between corresponding points (weighted Kabsch).
+   With equal weights the result is the same as pcl::registration::TransformationEstimationSVD
+   @param[in] source points from the source sensor
+   @param[in] target corresponding points from the reference sensor
+   @param[in] weights weight of each pair of points, usually the inverse of their variance
+   @return Matrix4f transformation that maps the source points onto the target points
+ */
+Matrix4f weightedRigidTransformation(const pcl::PointCloud<pcl::PointXYZ>& source, const pcl::PointCloud<pcl::PointXYZ>& target,
+	const vector<float>& weights)
+{
+	Vector3d source_centroid = Vector3d::Zero();
+	Vector3d target_centroid = Vector3d::Zero();
+	double weight_sum = 0;
+	for (int i = 0; i < source.points.size(); i++)
+	{
+		source_centroid += weights[i] * Vector3d(source.points[i].x, source.points[i].y, source.points[i].z);
+		target_centroid += weights[i] * Vector3d(target.points[i].x, target.points[i].y, target.points[i].z);
+		weight_sum += weights[i];
+	}
+	Matrix4f transformation = Matrix4f::Identity();
+	if (weight_sum <= 0)
+		return transformation;
+	source_centroid /= weight_sum;
+	target_centroid /= weight_sum;
+
+	// Weighted cross-covariance of the centered points
+	Matrix3d H = Matrix3d::Zero();
+	for (int i = 0; i < source.points.size(); i++)
+	{
+		Vector3d s = Vector3d(source.points[i].x, source.points[i].y, source.points[i].z) - source_centroid;
+		Vector3d t = Vector3d(target.points[i].x, target.points[i].y, target.points[i].z) - target_centroid;
+		H += weights[i] * s * t.transpose();
+	}
+
+	JacobiSVD<Matrix3d> svd(H, ComputeFullU | ComputeFullV);
+	Matrix3d V = svd.matrixV();
+	Matrix3d R = V * svd.matrixU().transpose();
+	if (R.determinant() < 0) // reflection
+	{
+		V.col(2) *= -1;
+		R = V * svd.matrixU().transpose();
+	}
+
+	transformation.block<3,3>(0,0) = R.cast<float>();
+	transformation.block<3,1>(0,3) = (target_centroid - R * source_centroid).cast<float>();
+	return transformation;
+}
+
+/**
+   @brief Variance of a detected ball center, the trace of its covariance
+   @param[in] detection ball detection
+   @return float variance [m^2]
+ */
+float detectionVariance(const calibration_gui::SphereDetection& detection)
+{
+	return detection.covariance[0] + detection.covariance[4] + detection.covariance[8];
+}
+
 /**
    @brief Transformation estimation between sensor pairs using the extrinsic calibration algorithm from OpenCV
    @param[out] camera geometric transformation of the calibrated sensor
@@ -179,31 +243,17 @@ void estimateTransformation(geometry_msgs::Pose & laser,pcl::PointCloud<pcl::Poi
    @param[out] cameraPnPCloud ball centers point cloud in the camera image plane
    @param[in] targetSensorName name of the reference sensor
    @param[in] cameraName name of the camera to be calibrated
+   @param[in] intrinsic_matrix camera matrix of the camera to be calibrated
+   @param[in] distortion_coeffs distortion coefficients of the camera to be calibrated
    @param[in] projImage image acquired from the camera where \p targetCloud is going to be projected
    @param[in] draw if true the projected points are drawn on the image
    @param[in] ransac if true the RANSAC extrinsic calibration algorithm is used
    @return 0 on success
  */
 int estimateTransformationCamera(geometry_msgs::Pose & camera, pcl::PointCloud<pcl::PointXYZ> targetCloud, pcl::PointCloud<pcl::PointXYZ> cameraPnPCloud,
-	const string targetSensorName, const string cameraName, const cv::Mat &projImage, const bool draw, const bool ransac)
+	const string targetSensorName, const string cameraName, const cv::Mat &intrinsic_matrix, const cv::Mat &distortion_coeffs,
+	const cv::Mat &projImage, const bool draw, const bool ransac)
 {
-	//read calibration paraneters
-	string a="/intrinsic_calibrations/ros_calib.yaml";
-	string path = ros::package::getPath("calibration_gui");
-	path += a;
-	cv::FileStorage fs(path, cv::FileStorage::READ);
-	if(!fs.isOpened())
-	{
-		cout<<"failed to open document"<<endl;
-		return -1;
-	}
-
-	// Matrices to store intrinsic parameters and distortion coefficients
-	cv::Mat intrinsic_matrix, distortion_coeffs;
-
-	fs["CM1"] >> intrinsic_matrix;
-	fs["D1"] >> distortion_coeffs;
-
 	// DEBUGGING =================================================================
 	// cout << intrinsic_matrix << endl;
 	// cout << distortion_coeffs << endl;
@@ -0,0 +1,118 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  camera_intrinsics.cpp
+ \brief Intrinsic parameters of every camera of the calibration, keyed by sensor namespace
+ \date   October, 2026
+*/
+
+#include "calibration_gui/camera_intrinsics.h"
+
+/**
+@brief Reads the intrinsics of every camera in the cameras map of a file, and the CM1 and D1 matrices
+@param[in] path intrinsic calibration file
+@return bool false if the file can't be read or has no intrinsics at all
+*/
+bool CameraIntrinsics::load(const std::string& path)
+{
+    cameras.clear();
+    fallback=Intrinsics();
+
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if(!fs.isOpened())
+        return false;
+
+    cv::FileNode entries=fs["cameras"];
+    if(entries.isMap())
+    {
+        for(cv::FileNodeIterator it=entries.begin(); it!=entries.end(); ++it)
+        {
+            Intrinsics camera;
+            (*it)["CM"] >> camera.cameraMatrix;
+            (*it)["D"] >> camera.distCoeffs;
+            if(camera.cameraMatrix.rows==3 && camera.cameraMatrix.cols==3)
+                cameras[(*it).name()]=camera;
+        }
+    }
+
+    fs["CM1"] >> fallback.cameraMatrix;
+    fs["D1"] >> fallback.distCoeffs;
+    if(fallback.cameraMatrix.rows!=3 || fallback.cameraMatrix.cols!=3)
+        fallback=Intrinsics();
+
+    return !cameras.empty() || !fallback.cameraMatrix.empty();
+}
+
+/**
+@brief Copy of the intrinsics of a camera
+@param[in] camera namespace of the camera nodes
+@param[in] useFallback true to use CM1 and D1 if the camera has no entry, only when it is the single camera of the session
+@param[out] cameraMatrix 3x3 camera matrix
+@param[out] distCoeffs distortion coefficients
+@return bool false if there are no intrinsics for the camera
+*/
+bool CameraIntrinsics::get(const std::string& camera, bool useFallback, cv::Mat& cameraMatrix, cv::Mat& distCoeffs) const
+{
+    std::map<std::string, Intrinsics>::const_iterator it=cameras.find(camera);
+    if(it==cameras.end() && !useFallback)
+        return false;
+    const Intrinsics& intrinsics=(it!=cameras.end() ? it->second : fallback);
+    if(intrinsics.cameraMatrix.empty())
+        return false;
+
+    cameraMatrix=intrinsics.cameraMatrix.clone();
+    distCoeffs=intrinsics.distCoeffs.clone();
+    return true;
+}
+
+/**
+@brief Camera matrix of another image window of the same sensor. Focal lengths and principal point are scaled by the
+ratio of binnings (pixel centres included) and the principal point is moved by the offset of the window; the
+distortion coefficients apply to normalised coordinates and don't change
+@param[in] cameraMatrix 3x3 camera matrix calibrated on the whole sensor with calibrationBinning binning
+@param[in] calibrationBinning binning of the calibrated images, in both directions
+@param[in] binningX horizontal binning of the window
+@param[in] binningY vertical binning of the window
+@param[in] offsetX first column of the window, in sensor pixels
+@param[in] offsetY first row of the window, in sensor pixels
+@return cv::Mat camera matrix of the window
+*/
+cv::Mat cameraMatrixForWindow(const cv::Mat& cameraMatrix, int calibrationBinning, int binningX, int binningY,
+                              int offsetX, int offsetY)
+{
+    cv::Mat window=cameraMatrix.clone();
+    double binning[2]={(double)binningX, (double)binningY};
+    int offset[2]={offsetX, offsetY};
+    for(int i=0; i<2; i++)
+    {
+        double scale=calibrationBinning/binning[i];
+        window.at<double>(i,i)=cameraMatrix.at<double>(i,i)*scale;
+        window.at<double>(i,2)=(calibrationBinning*cameraMatrix.at<double>(i,2)-offset[i])/binning[i]
+                               +(calibrationBinning-binning[i])/(2*binning[i]);
+    }
+    return window;
+}
@@ -33,6 +33,7 @@
 
 #include <lidar_segmentation/lidar_segmentation.h>
 #include "calibration_gui/sick_ldmrs.h"
+#include "calibration_gui/sphere_fitting.h"
 #include <lidar_segmentation/clustering.h>
 #include <lidar_segmentation/groundtruth.h>
 #include <cmath>
@@ -45,7 +46,7 @@
 
 
 /**
-@brief Calculation of the circle properties
+@brief Calculation of the circle properties (Taubin fit, see sphere_fitting.h)
 @param[in] cluster corresponding cluster of the detected circle
 @param[out] R radius of the circle
 @param[out] Center coordinates of the circle center
@@ -53,40 +54,32 @@
 */
 void CalculateCircle(ClusterPtr cluster, double& R, Point& Center)
 {
-    double Sx=0,Sy=0,x_m,y_m,u,v,Suu,Svv,Suv,Suuu,Svvv,Suvv,Svuu,uc,vc;
-    for(int i=0;i<cluster->support_points.size();i++)
-    {
-        Sx+=cluster->support_points[i]->x;
-        Sy+=cluster->support_points[i]->y;
-    }
-    x_m=Sx/cluster->support_points.size();
-    y_m=Sy/cluster->support_points.size();
-
-    for(int i=0;i<cluster->support_points.size();i++)
-    {
-        u=cluster->support_points[i]->x-x_m;
-        v=cluster->support_points[i]->y-y_m;
-        Suu+=pow(u,2);
-        Svv+=pow(v,2);
-        Suv+=u*v;
-        Suuu+=pow(u,3);
-        Svvv+=pow(v,3);
-        Svuu+=v*pow(u,2);
-        Suvv+=u*pow(v,2);
-    }
+    R=0;
+    CircleFit fit;
+    if(!CalculateCircle(cluster, fit))
+        return;
 
-    vc=(Suu*0.5*(Svvv+Svuu)-Suv*0.5*(Suuu+Suvv))/(Svv*Suu-Suv*Suv);
-    uc=(0.5*(Suuu+Suvv)-vc*Suv)/Suu;
-    vc=vc+y_m;
-    uc=uc+x_m;
+    Center.x=fit.x;
+    Center.y=fit.y;
+    R=fit.radius;
+}
 
-    Center.x=uc;
-    Center.y=vc;
+/**
+@brief Calculation of the circle properties, with the residual and covariance of the fit
+@param[in] cluster corresponding cluster of the detected circle
+@param[out] fit fitted circle
+@return true on success, false if the cluster has less than 3 points or they are collinear
+*/
+bool CalculateCircle(ClusterPtr cluster, CircleFit& fit)
+{
+    if(cluster->support_points.empty())
+        return false;
 
+    CircleMoments moments(cluster->support_points[0]->x, cluster->support_points[0]->y);
     for(int i=0;i<cluster->support_points.size();i++)
-        R+=sqrt(pow((cluster->support_points[i]->x-uc),2) + pow((cluster->support_points[i]->y-vc),2));
+        moments.add(cluster->support_points[i]->x, cluster->support_points[i]->y);
 
-    R=R/cluster->support_points.size();
+    return fitCircleTaubin(moments, fit);
 }
 
 /**
@@ -113,42 +106,49 @@ void circlePoints(vector<ClusterPtr>& circle_points, double radius, double centr
 }
 
 /**
-@brief Convert data to XYZ
-@param[in] scan laser scan
-@param[out] data_gt converted data
-@return void
+@brief Mean and standard deviation of the angles inscribed in a cluster, from its end points to each inner point.
+The statistics are computed online (Welford's algorithm) so no per-cluster buffer is needed, whatever the number of points
+@param[in] cluster cluster to be tested for a circle arc
+@param[out] mean average inscribed angle [deg]
+@param[out] std standard deviation of the inscribed angles [deg]
+@return int number of inscribed angles used
 */
-void convertDataToXY(sensor_msgs::LaserScan scan, C_DataFromFilePtr& data_gt)
+int inscribedAngleStatistics(ClusterPtr cluster, double& mean, double& std)
 {
-    C_DataFromFilePtr data (new C_DataFromFile);
-    int s=scan.ranges.size();
-    int l=1;
-    double X, Y;
-    for(int n=0; n<s; n++)
+    int segment_init=0;
+    int segment_end=cluster->support_points.size()-1;
+    PointPtr init=cluster->support_points[segment_init];
+    PointPtr end=cluster->support_points[segment_end];
+
+    double m=0, M2=0;
+    int n=0;
+    for (int j=segment_init+1; j<segment_end-1; j++)
     {
-            double angle, d, x, y, z;
-            d=scan.ranges[n];
-            z=0;
-            angle = scan.angle_min + n*scan.angle_increment;
-            if(angle>=0)
-            {
-                x=d*cos(angle);
-                y=d*sin(angle);
-            }
-            else
-            {
-                angle = abs(angle);
-                x = d*cos(angle);
-                y = -d*sin(angle);
-            }
-
-            X+=x;
-            Y+=y;
-            data->x_valuesf.push_back(x);
-            data->y_valuesf.push_back(y);
-            data->z_valuesf.push_back(z);
-            data->labels.push_back(l);
+        PointPtr p=cluster->support_points[j];
+
+        // use 3D but actually Z = 0 because laserscan is planar
+        double vecA[3],vecB[3];
+        vecA[0] = init->x - p->x;
+        vecA[1] = init->y - p->y;
+        vecA[2] = init->z - p->z;
+
+        vecB[0] = end->x - p->x;
+        vecB[1] = end->y - p->y;
+        vecB[2] = end->z - p->z;
+
+        double c = inner_product(vecA, vecA+3, vecB, 0.0)
+                   / sqrt(inner_product(vecA, vecA+3, vecA, 0.0) * inner_product(vecB, vecB+3, vecB, 0.0));
+        // rounding can take the cosine slightly out of [-1,1]
+        double angle = acos(max(-1.0, min(1.0, c)));
+
+        n++;
+        double delta = angle - m;
+        m += delta/n;
+        M2 += delta*(angle - m);
     }
-    data->iteration=s;
-    data_gt=data;
+
+    // conversion to degree
+    mean = m/M_PI*180;
+    std = n>1 ? sqrt(M2/(n-1))/M_PI*180 : 0;
+    return n;
 }
@@ -0,0 +1,158 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  depth_candidates.cpp
+ \brief Ball candidates from the depth of organized point clouds, before any sphere fitting
+ \date   October, 2026
+*/
+
+#include "calibration_gui/depth_candidates.h"
+#include <cmath>
+#include <algorithm>
+
+/**
+@brief Comparison of candidates by score, best first
+*/
+static bool compareCandidates(const SphereCandidate& a, const SphereCandidate& b)
+{
+    return a.score<b.score;
+}
+
+/**
+@brief DepthBlobDetector constructor
+@param[in] ballDiameter ball diameter
+@param[in] discontinuity depth jump between neighbour pixels that separates blobs, relative to the depth
+@param[in] tolerance relative tolerance on the blob width and height
+@param[in] minPixels smallest blob considered, in pixels
+*/
+DepthBlobDetector::DepthBlobDetector(double ballDiameter, double discontinuity, double tolerance, int minPixels)
+{
+    diameter=ballDiameter;
+    this->discontinuity=discontinuity;
+    this->tolerance=tolerance;
+    this->minPixels=minPixels;
+}
+
+/**
+@brief Finds the blobs of an organized cloud that may be the ball.
+Single pass flood fill (4-connectivity) over the pixels with a valid depth, O(pixels)
+@param[in] cloud organized point cloud
+@param[out] candidates blobs with the size of the ball, best match first. Empty if the cloud is not organized
+@return void
+*/
+void DepthBlobDetector::detect(const pcl::PointCloud<pcl::PointXYZ>& cloud, vector<SphereCandidate>& candidates)
+{
+    candidates.clear();
+    int width=cloud.width, height=cloud.height;
+    if(height<=1)
+        return;
+
+    size_t size=(size_t)width*height;
+    labels.assign(size, -1);
+    stack.reserve(size);
+
+    const pcl::PointXYZ* p=&cloud.points[0];
+    int label=0;
+    for(size_t seed=0; seed<size; seed++)
+    {
+        if(labels[seed]!=-1)
+            continue;
+        if(!(p[seed].z>0)) // NaN or no return
+        {
+            labels[seed]=-2;
+            continue;
+        }
+
+        // flood fill the blob of the seed, keeping its metric and pixel extents
+        int count=0;
+        double xmin=p[seed].x, xmax=xmin, ymin=p[seed].y, ymax=ymin, zsum=0;
+        int umin=width, umax=-1, vmin=height, vmax=-1;
+        stack.clear();
+        stack.push_back(seed);
+        labels[seed]=label;
+        while(!stack.empty())
+        {
+            int i=stack.back();
+            stack.pop_back();
+            count++;
+
+            const pcl::PointXYZ& q=p[i];
+            xmin=std::min(xmin, (double)q.x);
+            xmax=std::max(xmax, (double)q.x);
+            ymin=std::min(ymin, (double)q.y);
+            ymax=std::max(ymax, (double)q.y);
+            zsum+=q.z;
+
+            int v=i/width, u=i-v*width;
+            umin=std::min(umin, u);
+            umax=std::max(umax, u);
+            vmin=std::min(vmin, v);
+            vmax=std::max(vmax, v);
+
+            int neighbours[4]={ u>0 ? i-1 : -1, u<width-1 ? i+1 : -1, v>0 ? i-width : -1, v<height-1 ? i+width : -1 };
+            double jump=discontinuity*q.z;
+            for(int k=0; k<4; k++)
+            {
+                int j=neighbours[k];
+                if(j<0 || labels[j]!=-1)
+                    continue;
+                if(!(p[j].z>0))
+                {
+                    labels[j]=-2;
+                    continue;
+                }
+                if(fabs(p[j].z-q.z)<jump)
+                {
+                    labels[j]=label;
+                    stack.push_back(j);
+                }
+            }
+        }
+
+        double w=xmax-xmin, h=ymax-ymin;
+        double ew=fabs(w/diameter-1), eh=fabs(h/diameter-1);
+        if(count>=minPixels && ew<=tolerance && eh<=tolerance)
+        {
+            SphereCandidate candidate;
+            candidate.depth=zsum/count;
+            candidate.width=w;
+            candidate.height=h;
+            candidate.score=std::max(ew, eh);
+
+            // the points are only gathered for the blobs that are kept, within their pixel bounding box
+            candidate.indices.reserve(count);
+            for(int v=vmin; v<=vmax; v++)
+                for(int u=umin; u<=umax; u++)
+                    if(labels[v*width+u]==label)
+                        candidate.indices.push_back(v*width+u);
+            candidates.push_back(candidate);
+        }
+        label++;
+    }
+
+    sort(candidates.begin(), candidates.end(), compareCandidates);
+}
@@ -0,0 +1,176 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  ellipse_fit_benchmark.cpp
+ \brief Accuracy of the camera ball center, bounding box against sub-pixel ellipse fit, on rendered spheres at known positions
+ \date   October, 2026
+ */
+
+#include "calibration_gui/ball_segmentation.h"
+#include "calibration_gui/ellipse_fitting.h"
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+using namespace cv;
+
+/**
+   @brief Renders a sphere in an undistorted image, 4x4 samples per pixel, with the ball colour of the detector
+   on a grey background
+   @param[in] K camera matrix
+   @param[in] center sphere center in the camera frame
+   @param[in] radius sphere radius
+   @param[out] img BGR image
+   @return void
+ */
+void renderSphere(const Mat &K, const double center[3], double radius, Mat &img)
+{
+	double fx = K.at<double>(0,0), fy = K.at<double>(1,1), cx = K.at<double>(0,2), cy = K.at<double>(1,2);
+	double c2 = center[0]*center[0] + center[1]*center[1] + center[2]*center[2];
+
+	for(int v = 0; v < img.rows; v++)
+	{
+		Vec3b *row = img.ptr<Vec3b>(v);
+		for(int u = 0; u < img.cols; u++)
+		{
+			int inside = 0;
+			for(int sy = 0; sy < 4; sy++)
+				for(int sx = 0; sx < 4; sx++)
+				{
+					// ray through the sample hits the sphere
+					double dx = (u + (sx + 0.5)/4 - 0.5 - cx)/fx, dy = (v + (sy + 0.5)/4 - 0.5 - cy)/fy;
+					double dc = dx*center[0] + dy*center[1] + center[2];
+					if(dc > 0 && dc*dc >= (dx*dx + dy*dy + 1)*(c2 - radius*radius))
+						inside++;
+				}
+			double c = inside/16.0;
+			row[u] = Vec3b(saturate_cast<uchar>(60*c + 120*(1-c)), saturate_cast<uchar>(20*c + 130*(1-c)), saturate_cast<uchar>(220*c + 110*(1-c)));
+		}
+	}
+}
+
+/**
+   @brief Renders the ball on a grid of positions and compares the center found from the bounding box of the contour,
+   as the Point Grey detector did, with the center from the sub-pixel ellipse fit
+   @param argc
+   @param argv ball diameter and the intrinsic calibration file (CM1)
+   @return int
+ */
+int main(int argc, char **argv)
+{
+	if(argc < 3)
+	{
+		cout << "Usage: ellipse_fit_benchmark <ball diameter> <ros_calib.yaml>" << endl;
+		return 1;
+	}
+
+	double radius = atof(argv[1])/2;
+	FileStorage fs(argv[2], FileStorage::READ);
+	Mat K;
+	fs["CM1"] >> K;
+	int width = (int)fs["image_width"], height = (int)fs["image_height"];
+	if(K.empty() || width <= 0 || height <= 0)
+	{
+		cout << "Could not read " << argv[2] << endl;
+		return 1;
+	}
+	double fx = K.at<double>(0,0), fy = K.at<double>(1,1), cx = K.at<double>(0,2), cy = K.at<double>(1,2);
+	double f = (fx + fy)/2;
+
+	BallSegmenter segmenter;
+	Mat img(height, width, CV_8UC3), imgBinary, imgCanny;
+	double errorBox = 0, errorEllipse = 0;
+	int count = 0;
+
+	printf("%7s %7s %7s | %12s %12s | %12s %12s\n", "x", "y", "z", "box [mm]", "box z [mm]", "fit [mm]", "fit z [mm]");
+
+	// positions up to 80% of the field of view, at 3 to 4 ball diameters steps in depth
+	for(int iz = 1; iz <= 3; iz++)
+		for(int iy = -1; iy <= 1; iy++)
+			for(int ix = -1; ix <= 1; ix++)
+			{
+				double z = 6*radius*iz;
+				double center[3] = { 0.8*ix*z*(width/2 - 2*radius*f/z)/f, 0.8*iy*z*(height/2 - 2*radius*f/z)/f, z };
+				renderSphere(K, center, radius, img);
+
+				GaussianBlur(segmenter.segment(img), imgBinary, Size(5, 5), 2, 2);
+				Canny(imgBinary, imgCanny, 100, 200, 3);
+				vector<vector<Point> > contours;
+				findContours(imgCanny, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
+				if(contours.empty())
+					continue;
+				size_t largest = 0;
+				for(size_t i = 1; i < contours.size(); i++)
+					if(contourArea(contours[i]) > contourArea(contours[largest]))
+						largest = i;
+				const vector<Point> &contour = contours[largest];
+
+				// bounding box
+				Rect r = boundingRect(contour);
+				int rb = r.width/2;
+				double dist = f*2*radius/(2*rb);
+				double box[3] = { (r.x + rb - cx)/fx*dist, (r.y + rb - cy)/fy*dist, dist };
+
+				// sub-pixel ellipse fit
+				vector<double> x, y, w;
+				for(size_t j = 0; j < contour.size(); j++)
+				{
+					double ex, ey, weight;
+					if(subpixelEdge(img.ptr<uchar>(0), img.step, imgBinary.ptr<uchar>(0), imgBinary.step, width, height,
+					                contour[j].x, contour[j].y, ex, ey, weight))
+					{
+						x.push_back((ex - cx)/fx);
+						y.push_back((ey - cy)/fy);
+						w.push_back(weight);
+					}
+				}
+				EllipseFit ellipse;
+				double fit[3];
+				if(x.size() < 6 || !fitEllipse(&x[0], &y[0], &w[0], x.size(), ellipse) || !sphereFromEllipse(ellipse, radius, fit))
+					continue;
+
+				double eb = 0, ef = 0;
+				for(int k = 0; k < 3; k++)
+				{
+					eb += (box[k] - center[k])*(box[k] - center[k]);
+					ef += (fit[k] - center[k])*(fit[k] - center[k]);
+				}
+				printf("%7.3f %7.3f %7.3f | %12.2f %12.2f | %12.2f %12.2f\n", center[0], center[1], center[2],
+				       sqrt(eb)*1000, (box[2] - center[2])*1000, sqrt(ef)*1000, (fit[2] - center[2])*1000);
+				errorBox += eb;
+				errorEllipse += ef;
+				count++;
+			}
+
+	if(count > 0)
+		printf("RMS error: bounding box %.2f mm, ellipse fit %.2f mm (%d positions)\n",
+		       sqrt(errorBox/count)*1000, sqrt(errorEllipse/count)*1000, count);
+	return 0;
+}
@@ -0,0 +1,392 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  ellipse_fitting.cpp
+ \brief Sub-pixel edges and direct least squares ellipse fitting of the ball outline in camera images
+ \date   October, 2026
+*/
+
+#include "calibration_gui/ellipse_fitting.h"
+#include <cmath>
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+
+/**
+@brief Bilinear interpolation of a BGR image
+@param[in] bgr 8 bit BGR image
+@param[in] step bytes per row
+@param[in] width image width
+@param[in] height image height
+@param[in] x column
+@param[in] y row
+@param[out] c interpolated colour
+@return false if the point is outside the image
+*/
+static bool sampleBGR(const uint8_t* bgr, size_t step, int width, int height, double x, double y, double c[3])
+{
+    if(!(x>=0 && y>=0 && x<width-1 && y<height-1))
+        return false;
+
+    int x0=(int)x, y0=(int)y;
+    double fx=x-x0, fy=y-y0;
+    const uint8_t* p=bgr+y0*step+3*x0;
+    const uint8_t* q=p+step;
+    for(int k=0; k<3; k++)
+        c[k]=(1-fy)*((1-fx)*p[k]+fx*p[k+3])+fy*((1-fx)*q[k]+fx*q[k+3]);
+    return true;
+}
+
+/**
+@brief Sub-pixel position of the ball edge along a normal. The colour profile across the edge is projected on the
+difference between the colour outside and inside, and the edge is where the projection crosses half way, which
+for a blurred or anti-aliased edge is where the ball covers half of the pixel
+@param[in] bgr 8 bit BGR image
+@param[in] step bytes per row
+@param[in] width image width
+@param[in] height image height
+@param[in] x column of a point close to the edge
+@param[in] y row of a point close to the edge
+@param[in] nx x component of the unit normal to the edge, pointing out of the ball
+@param[in] ny y component of the unit normal to the edge, pointing out of the ball
+@param[in] halfWidth length of the profile on each side of the point [pixels]
+@param[out] t position of the edge along the normal, from (x, y) [pixels]
+@param[out] contrast norm of the colour difference across the edge, the weight of the edge point
+@return false if the profile leaves the image, is flat, or does not cross
+*/
+bool edgeCrossing(const uint8_t* bgr, size_t step, int width, int height, double x, double y, double nx, double ny,
+                  double halfWidth, double& t, double& contrast)
+{
+    const double spacing=0.5;
+    int samples=(int)(2*halfWidth/spacing)+1;
+    if(samples<4)
+        return false;
+
+    std::vector<double> profile(3*samples);
+    for(int k=0; k<samples; k++)
+    {
+        double s=-halfWidth+k*spacing;
+        if(!sampleBGR(bgr, step, width, height, x+s*nx, y+s*ny, &profile[3*k]))
+            return false;
+    }
+
+    double inside[3], d[3], d2=0;
+    for(int c=0; c<3; c++)
+    {
+        inside[c]=(profile[c]+profile[3+c])/2;
+        d[c]=(profile[3*(samples-1)+c]+profile[3*(samples-2)+c])/2-inside[c];
+        d2+=d[c]*d[c];
+    }
+    contrast=std::sqrt(d2);
+    if(d2==0)
+        return false;
+
+    // crossing closest to the point
+    bool found=false;
+    double previous=0;
+    for(int k=0; k<samples; k++)
+    {
+        double s=0;
+        for(int c=0; c<3; c++)
+            s+=(profile[3*k+c]-inside[c])*d[c];
+        s/=d2;
+
+        if(k>0 && previous<0.5 && s>=0.5)
+        {
+            double crossing=-halfWidth+(k-1+(0.5-previous)/(s-previous))*spacing;
+            if(!found || std::fabs(crossing)<std::fabs(t))
+                t=crossing;
+            found=true;
+        }
+        previous=s;
+    }
+    return found;
+}
+
+/**
+@brief Sub-pixel edge point of the ball, from a pixel of its contour in a smoothed binary image (e.g. blurred), whose
+gradient gives the normal to the edge
+@param[in] bgr 8 bit BGR image
+@param[in] bgrStep bytes per row of the BGR image
+@param[in] mask 8 bit smoothed binary image of the ball, of the same size
+@param[in] maskStep bytes per row of the binary image
+@param[in] width image width
+@param[in] height image height
+@param[in] u column of the contour pixel
+@param[in] v row of the contour pixel
+@param[out] x column of the edge point
+@param[out] y row of the edge point
+@param[out] weight contrast of the edge
+@return false if there is no edge close to the pixel
+*/
+bool subpixelEdge(const uint8_t* bgr, size_t bgrStep, const uint8_t* mask, size_t maskStep, int width, int height,
+                  int u, int v, double& x, double& y, double& weight)
+{
+    if(u<1 || v<1 || u>=width-1 || v>=height-1)
+        return false;
+
+    const uint8_t* m=mask+v*maskStep+u;
+    double gx=(double)m[1]-m[-1], gy=(double)m[maskStep]-m[-(long)maskStep];
+    double g=std::sqrt(gx*gx+gy*gy);
+    if(g==0)
+        return false;
+
+    // the gradient points into the ball
+    double nx=-gx/g, ny=-gy/g, t;
+    if(!edgeCrossing(bgr, bgrStep, width, height, u, v, nx, ny, 3, t, weight))
+        return false;
+    x=u+t*nx;
+    y=v+t*ny;
+    return true;
+}
+
+/**
+@brief Covariance of a fitted ellipse, sigma^2*(J'WJ)^-1 of the first order geometric distance of the points, with
+the weights scaled to a mean of 1. The angle is held fixed: it is undetermined for a nearly circular outline, and the
+sphere center recovered from the ellipse does not depend on it
+@param[in] x x coordinates of the points
+@param[in] y y coordinates of the points
+@param[in] w weights of the points, NULL for equal weights
+@param[in] n number of points
+@param[in] W sum of the weights
+@param[in,out] fit fitted ellipse, with its residual set. Its covariance is filled, or left at 0 if J'WJ is singular
+@return void
+*/
+static void ellipseCovariance(const double* x, const double* y, const double* w, size_t n, double W, EllipseFit& fit)
+{
+    double c=std::cos(fit.angle), s=std::sin(fit.angle);
+    double a2=fit.a*fit.a, b2=fit.b*fit.b;
+
+    // distance g/|grad g| of g = u^2/a^2+v^2/b^2-1, with (u, v) the point in the frame of the ellipse
+    Eigen::Matrix4d JtJ=Eigen::Matrix4d::Zero();
+    for(size_t i=0; i<n; i++)
+    {
+        double dx=x[i]-fit.x, dy=y[i]-fit.y;
+        double u=dx*c+dy*s, v=-dx*s+dy*c;
+        double gu=2*u/a2, gv=2*v/b2;
+        double g=std::sqrt(gu*gu+gv*gv);
+        if(g==0)
+            continue;
+        Eigen::Vector4d J(-(gu*c-gv*s)/g, -(gu*s+gv*c)/g, -2*u*u/(a2*fit.a)/g, -2*v*v/(b2*fit.b)/g);
+        JtJ+=(w ? w[i]*n/W : 1)*J*J.transpose();
+    }
+
+    // unbiased variance of the residuals, 5 parameters were fitted
+    double sigma2=fit.residual*fit.residual*(n>5 ? n/(n-5.0) : 1);
+
+    Eigen::FullPivLU<Eigen::Matrix4d> lu(JtJ);
+    if(!lu.isInvertible())
+        return;
+    Eigen::Matrix4d cov=sigma2*lu.inverse();
+    for(int i=0; i<4; i++)
+        for(int j=0; j<4; j++)
+            fit.covariance[i][j]=cov(i, j);
+}
+
+/**
+@brief Weighted direct least squares ellipse fit (Fitzgibbon, Pilu and Fisher), in the numerically stable form of
+Halir and Flusser. The points are centered and scaled before the fit
+@param[in] x x coordinates of the points
+@param[in] y y coordinates of the points
+@param[in] w weights of the points, NULL for equal weights
+@param[in] n number of points
+@param[out] fit fitted ellipse
+@return false if there are less than 6 points or the points do not define an ellipse
+*/
+bool fitEllipse(const double* x, const double* y, const double* w, size_t n, EllipseFit& fit)
+{
+    fit.points=n;
+    if(n<6)
+        return false;
+
+    double W=0, mx=0, my=0;
+    for(size_t i=0; i<n; i++)
+    {
+        double wi= w ? w[i] : 1;
+        W+=wi;
+        mx+=wi*x[i];
+        my+=wi*y[i];
+    }
+    if(W<=0)
+        return false;
+    mx/=W;
+    my/=W;
+
+    double scale=0;
+    for(size_t i=0; i<n; i++)
+        scale+=(w ? w[i] : 1)*((x[i]-mx)*(x[i]-mx)+(y[i]-my)*(y[i]-my));
+    scale=std::sqrt(scale/W);
+    if(scale==0)
+        return false;
+
+    // scatter matrices of the quadratic (u^2, uv, v^2) and linear (u, v, 1) parts
+    Eigen::Matrix3d S1=Eigen::Matrix3d::Zero(), S2=Eigen::Matrix3d::Zero(), S3=Eigen::Matrix3d::Zero();
+    for(size_t i=0; i<n; i++)
+    {
+        double wi= w ? w[i] : 1;
+        double u=(x[i]-mx)/scale, v=(y[i]-my)/scale;
+        Eigen::Vector3d d1(u*u, u*v, v*v), d2(u, v, 1);
+        S1+=wi*d1*d1.transpose();
+        S2+=wi*d1*d2.transpose();
+        S3+=wi*d2*d2.transpose();
+    }
+
+    Eigen::FullPivLU<Eigen::Matrix3d> lu(S3);
+    if(!lu.isInvertible())
+        return false;
+    Eigen::Matrix3d T=-lu.inverse()*S2.transpose();
+    Eigen::Matrix3d M=S1+S2*T;
+
+    // premultiplied by the inverse of the constraint 4AC-B^2=1
+    Eigen::Matrix3d C;
+    C.row(0)=M.row(2)/2;
+    C.row(1)=-M.row(1);
+    C.row(2)=M.row(0)/2;
+
+    Eigen::EigenSolver<Eigen::Matrix3d> solver(C);
+    int best=-1;
+    for(int k=0; k<3; k++)
+    {
+        Eigen::Vector3d v=solver.eigenvectors().col(k).real();
+        if(4*v(0)*v(2)-v(1)*v(1)>0)
+            best=k;
+    }
+    if(best<0)
+        return false;
+
+    Eigen::Vector3d a1=solver.eigenvectors().col(best).real();
+    Eigen::Vector3d a2=T*a1;
+    double A=a1(0), B=a1(1), Cc=a1(2), D=a2(0), E=a2(1), F=a2(2);
+
+    // center, and the conic at the center
+    double det=4*A*Cc-B*B;
+    double uc=(B*E-2*Cc*D)/det;
+    double vc=(B*D-2*A*E)/det;
+    double Fc=F+(D*uc+E*vc)/2;
+    if(Fc>0)
+    {
+        A=-A; B=-B; Cc=-Cc; D=-D; E=-E; F=-F; Fc=-Fc;
+    }
+
+    double mean=(A+Cc)/2, diff=std::sqrt((A-Cc)*(A-Cc)/4+B*B/4);
+    double large=mean+diff, small=mean-diff;
+    if(small<=0 || Fc>=0)
+        return false;
+
+    fit.x=mx+scale*uc;
+    fit.y=my+scale*vc;
+    fit.a=scale*std::sqrt(-Fc/small);
+    fit.b=scale*std::sqrt(-Fc/large);
+    fit.angle=0.5*std::atan2(B, A-Cc)+M_PI/2;
+
+    // Sampson distance of the points
+    double sum=0;
+    for(size_t i=0; i<n; i++)
+    {
+        double u=(x[i]-mx)/scale, v=(y[i]-my)/scale;
+        double f=A*u*u+B*u*v+Cc*v*v+D*u+E*v+F;
+        double gu=2*A*u+B*v+D, gv=B*u+2*Cc*v+E;
+        double g2=gu*gu+gv*gv;
+        if(g2>0)
+            sum+=(w ? w[i] : 1)*f*f/g2;
+    }
+    fit.residual=scale*std::sqrt(sum/W);
+    ellipseCovariance(x, y, w, n, W, fit);
+    return true;
+}
+
+/**
+@brief Center of a sphere from the ellipse of its outline in a normalized image (focal length 1, principal point at
+the origin). The outline is the section of the cone tangent to the sphere. With alpha the angle of the sphere center
+to the optical axis and theta the half angle of the cone, the semi-axes are a = sin(theta)*cos(theta)/k and
+b = sin(theta)/sqrt(k), with k = cos(alpha)^2-sin(theta)^2, so tan(theta) = b^2/a and the distance to the center is
+radius/sin(theta). The ellipse center is at (tan(alpha+theta)+tan(alpha-theta))/2 along the major axis, further from
+the principal point than the projection tan(alpha) of the sphere center, which is solved from it
+@param[in] ellipse ellipse of the outline, in normalized image coordinates
+@param[in] radius sphere radius
+@param[out] center sphere center in the camera frame
+@return false if the ellipse is degenerate
+*/
+bool sphereFromEllipse(const EllipseFit& ellipse, double radius, double center[3])
+{
+    if(ellipse.a<=0 || ellipse.b<=0)
+        return false;
+
+    double t=ellipse.b*ellipse.b/ellipse.a;
+    double t2=t*t;
+
+    // tan(alpha) from r*t^2*T^2+(1+t^2)*T-r = 0, in the form stable for small r
+    double r=std::sqrt(ellipse.x*ellipse.x+ellipse.y*ellipse.y);
+    double T=2*r/((1+t2)+std::sqrt((1+t2)*(1+t2)+4*r*r*t2));
+    double ux= r>0 ? ellipse.x/r : 0, uy= r>0 ? ellipse.y/r : 0;
+
+    // distance radius/sin(theta), along the direction (T*u, 1)
+    double distance=radius*std::sqrt(1+t2)/t;
+    double z=distance/std::sqrt(1+T*T);
+    center[0]=z*T*ux;
+    center[1]=z*T*uy;
+    center[2]=z;
+    return true;
+}
+
+/**
+@brief Covariance of the sphere center recovered from the ellipse of its outline (sphereFromEllipse), propagated from
+the covariance of the ellipse with the Jacobian of sphereFromEllipse, by central differences
+@param[in] ellipse ellipse of the outline, in normalized image coordinates, with its covariance
+@param[in] radius sphere radius
+@param[out] cov covariance of the sphere center in the camera frame, 0 if the ellipse is degenerate
+@return void
+*/
+void sphereCovarianceFromEllipse(const EllipseFit& ellipse, double radius, double cov[3][3])
+{
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            cov[i][j]=0;
+
+    // Jacobian of the center in relation to (x, y, a, b)
+    double J[3][4];
+    double step=1e-4*ellipse.b;
+    for(int k=0; k<4; k++)
+    {
+        EllipseFit plus=ellipse, minus=ellipse;
+        double* p[4]={&plus.x, &plus.y, &plus.a, &plus.b};
+        double* m[4]={&minus.x, &minus.y, &minus.a, &minus.b};
+        *p[k]+=step;
+        *m[k]-=step;
+        double cp[3], cm[3];
+        if(!sphereFromEllipse(plus, radius, cp) || !sphereFromEllipse(minus, radius, cm))
+            return;
+        for(int i=0; i<3; i++)
+            J[i][k]=(cp[i]-cm[i])/(2*step);
+    }
+
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            for(int k=0; k<4; k++)
+                for(int l=0; l<4; l++)
+                    cov[i][j]+=J[i][k]*ellipse.covariance[k][l]*J[j][l];
+}
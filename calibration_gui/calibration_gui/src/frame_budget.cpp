@@ -0,0 +1,146 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  frame_budget.cpp
+ \brief Per-frame time budget of the ball detectors, from the sensor rate
+ \date   October, 2026
+*/
+
+#include "calibration_gui/frame_budget.h"
+#include <algorithm>
+
+/**
+@brief FrameBudget constructor
+@param[in] rate sensor frame rate [Hz]
+@param[in] fraction fraction of the sensor period available for a frame
+@param[in] minIterations fewest RANSAC iterations granted, even past the budget
+@param[in] maxIterations most RANSAC iterations granted
+@param[in] minLeaf voxel size when the frames fit in the budget, 0 if the detector does not downsample
+@param[in] maxLeaf largest voxel size
+*/
+FrameBudget::FrameBudget(double rate, double fraction, int minIterations, int maxIterations, double minLeaf, double maxLeaf)
+{
+    this->fraction=fraction;
+    this->minIterations=minIterations;
+    this->maxIterations=maxIterations;
+    this->minLeaf=minLeaf;
+    this->maxLeaf=std::max(minLeaf, maxLeaf);
+    leaf=minLeaf;
+    cost=0;
+    last=0;
+    granted=0;
+    starved=false;
+    setRate(rate);
+}
+
+/**
+@brief Sets the sensor frame rate
+@param[in] rate sensor frame rate [Hz]
+@return void
+*/
+void FrameBudget::setRate(double rate)
+{
+    limit= rate>0 ? fraction/rate : 0;
+}
+
+/**
+@brief Marks the start of a frame
+@return void
+*/
+void FrameBudget::start()
+{
+    begin=ros::WallTime::now();
+    granted=0;
+    starved=false;
+}
+
+/**
+@brief RANSAC iterations that fit in the time left of the frame
+@param[in] points number of points of the cloud searched
+@return number of iterations, between the minimum and the maximum
+*/
+int FrameBudget::iterations(size_t points)
+{
+    int n=maxIterations;
+    if(cost>0 && limit>0 && points>0)
+    {
+        double left=limit-(ros::WallTime::now()-begin).toSec();
+        double fit=left/(cost*points);
+        if(fit<minIterations)
+            starved=true;
+        n=(int)std::min((double)maxIterations, std::max((double)minIterations, fit));
+    }
+    granted=std::max(granted, n);
+    return n;
+}
+
+/**
+@brief Updates the cost of an iteration with a measured RANSAC run
+@param[in] points number of points of the cloud searched
+@param[in] iterations iterations drawn
+@param[in] seconds time taken by the run
+@return void
+*/
+void FrameBudget::ransacDone(size_t points, int iterations, double seconds)
+{
+    if(points==0 || iterations<=0)
+        return;
+
+    double measured=seconds/((double)iterations*points);
+    cost= cost>0 ? 0.8*cost+0.2*measured : measured;
+}
+
+/**
+@brief Marks the end of a frame, and adapts the voxel size
+@return void
+*/
+void FrameBudget::finish()
+{
+    last=(ros::WallTime::now()-begin).toSec();
+    if(limit<=0 || maxLeaf<=0)
+        return;
+
+    if(starved || last>limit)
+        leaf=std::min(leaf*1.25, maxLeaf);
+    else if(last<0.5*limit)
+        leaf=std::max(leaf/1.25, minLeaf);
+}
+
+/**
+@brief Timing of the last frame, to publish
+@return timing message, with the header stamp left to the caller
+*/
+calibration_gui::DetectionTiming FrameBudget::timing() const
+{
+    calibration_gui::DetectionTiming msg;
+    msg.budget=limit;
+    msg.elapsed=last;
+    msg.overrun= limit>0 && last>limit;
+    msg.iterations=granted;
+    msg.leaf_size=leaf;
+    return msg;
+}
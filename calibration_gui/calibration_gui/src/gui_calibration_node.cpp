@@ -42,10 +42,12 @@
 #include "calibration_gui/gui_mainwindow.h"
 #include "ui_mainwindow.h"
 #include "calibration_gui/calibration.h"
+#include "calibration_gui/camera_intrinsics.h"
 #include "calibration_gui/visualization_rviz_calibration.h"
 
 // Generic includes
 #include <string>
+#include <algorithm>
 #include <std_msgs/String.h>
 #include <sstream>
 #include <QDebug>
@@ -142,11 +144,14 @@ void QNode::run() {
 	CircleCentroids centroids(calibrationNodes, isCamera);
 
 	vector<pcl::PointXYZ> sensorsBallCenters;
+	vector<calibration_gui::SphereDetection> sensorsDetections;
 	vector<pcl::PointXYZ> camCentroidPnP;
 	vector<cv::Mat> camImage;
 
 	// Vector for containing future pointclouds for each sensor
 	vector<pcl::PointCloud<pcl::PointXYZ> > sensorClouds;
+	// Variance of each acquired ball center, used to weight the points in the transformation estimation
+	vector<vector<float> > sensorVariances(calibrationNodes.size());
 	// Vector for containing image pointclouds from cameras - solvePnP method
 	vector<pcl::PointCloud<pcl::PointXYZ> > cameraCloudsPnP;
 	for (int i=0; i < calibrationNodes.size(); i++)
@@ -176,6 +181,33 @@ void QNode::run() {
 	}
 	sensorPoses.front().orientation.w = 1.0; // so it can be multiplied by transformations later, only the reference sensor needs this
 
+	// Intrinsics of each camera, read once from the entry named after its namespace. CM1 and D1 describe a single
+	// camera, so they are only used for a camera without an entry when it is the only one; otherwise the calibration
+	// doesn't start
+	vector<cv::Mat> cameraMatrices, cameraDistortions;
+	CameraIntrinsics intrinsics;
+	string intrinsicsPath = ros::package::getPath("calibration_gui") + "/intrinsic_calibrations/ros_calib.yaml";
+	if (!intrinsics.load(intrinsicsPath))
+		cout << "failed to read the camera intrinsics from " << intrinsicsPath << endl;
+	bool singleCamera = std::count(isCamera.begin(), isCamera.end(), true) == 1;
+	for (int i=0; i < calibrationNodes.size(); i++)
+	{
+		if (isCamera[i])
+		{
+			cv::Mat cameraMatrix, distortion;
+			if (!intrinsics.get(calibrationNodes[i], singleCamera, cameraMatrix, distortion))
+			{
+				cout << "no intrinsics for " << calibrationNodes[i] << " in " << intrinsicsPath
+				     << (singleCamera ? "" : ", each camera of a multi-camera session needs its own entry") << endl;
+				doCalibration = false;
+			}
+			else if (!intrinsics.contains(calibrationNodes[i]))
+				cout << "no intrinsics for " << calibrationNodes[i] << ", using CM1 and D1" << endl;
+			cameraMatrices.push_back(cameraMatrix);
+			cameraDistortions.push_back(distortion);
+		}
+	}
+
 	// Pointclouds used for Rviz visualization
 	vector<geometry_msgs::Pose> visualizationPoses;
 	vector<pcl::PointCloud<pcl::PointXYZ> > visualizationClouds;
@@ -192,11 +224,16 @@ void QNode::run() {
 	float dist;
 	vector<float> eu_dist;
 
+	// Detections less precise than this (standard deviation of the ball center, in meters) are not acquired
+	double max_centroid_std;
+	ros::param::param<double>("~max_centroid_std", max_centroid_std, 0.05);
+
 	ros::Rate loop_rate(50);
 
 	while(count < num_of_points && ros::ok() && doCalibration)
 	{
 		sensorsBallCenters = centroids.getSensorsBallCenters();
+		sensorsDetections = centroids.getSensorsDetections();
 		camCentroidPnP = centroids.getCamCentroidPnP();
 		camImage = centroids.getCamImage();
 
@@ -204,9 +241,10 @@ void QNode::run() {
 
 		int finder = 0;
 		bool found = false;
-		while ( finder < sensorsBallCenters.size() )
+		while ( finder < sensorsDetections.size() )
 		{
-			if (sensorsBallCenters[finder].x == -999)
+			if (!sensorsDetections[finder].valid ||
+			    detectionVariance(sensorsDetections[finder]) > max_centroid_std*max_centroid_std)
 			{
 				found = true;
 				break;
@@ -268,6 +306,7 @@ void QNode::run() {
 				{
 					cout << "crash" << sensorsBallCenters[i] << endl;
 					sensorClouds[i].push_back(sensorsBallCenters[i]); // sensorCLouds now contains ball center points for every sensor
+					sensorVariances[i].push_back(detectionVariance(sensorsDetections[i]));
 					qDebug() << "nocrash";
 					if (isCamera[i])
 					{
@@ -334,13 +373,28 @@ void QNode::run() {
 		int cameraCounter = 0;
 		for (int i = 1; i < sensorsBallCenters.size(); i++) // starts with i=1 because for i=0 the target and uncalibrated sensor are the same
 		{
+			// Each pair of points is weighted by the inverse of the sum of the variances of both detections.
+			// Without a covariance for every pair the estimation is unweighted
+			vector<float> weights;
+			for (int j = 0; j < sensorVariances[i].size(); j++)
+			{
+				float variance = sensorVariances.front()[j] + sensorVariances[i][j];
+				if (variance <= 0)
+				{
+					weights.clear();
+					break;
+				}
+				weights.push_back(1/variance);
+			}
+
 			// Estimating rigid transform between target sensor and other sensors
 			estimateTransformation(sensorPoses[i], sensorClouds.front(), sensorClouds[i],
-			                       calibrationNodes.front(), calibrationNodes[i]);
+			                       calibrationNodes.front(), calibrationNodes[i], weights);
 			if (isCamera[i])
 			{
 				estimateTransformationCamera(cameraPosesPnP[cameraCounter], sensorClouds.front(), cameraCloudsPnP[cameraCounter],
-				                             calibrationNodes.front(), calibrationNodes[i], camImage[cameraCounter], true, true);
+				                             calibrationNodes.front(), calibrationNodes[i], cameraMatrices[cameraCounter],
+				                             cameraDistortions[cameraCounter], camImage[cameraCounter], true, true);
 				cameraCounter++;
 			}
 		}
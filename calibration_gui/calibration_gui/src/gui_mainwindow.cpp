@@ -344,7 +344,10 @@ void MainWindow::on_bt_start_nodes_clicked()
         QString program = "roslaunch";
         QStringList arguments;
 
-        // Go trough the QTreewidget and launch nodes according to the user-selected sensors
+        // Sensors selected by the user: the reference one (i=0, without a checkbox) and the checked ones
+        QList<QTreeWidgetItem*> items;
+        QStringList sensors;
+        int cameras = 0;
         for (int i=0; i < ui->treeWidget->topLevelItemCount(); i++)
         {
 
@@ -355,17 +358,24 @@ void MainWindow::on_bt_start_nodes_clicked()
             if (i==0 || qobject_cast<QCheckBox*>(widget)->checkState() == Qt::Checked) // Do not reverse the order, for i=1, widget is NULL
             {
                 widget = ui->treeWidget->itemWidget(item, 0); // ComboBox widget is in column 0
-                QString sensor = qobject_cast<QComboBox*>(widget)->currentText(); // Gets ComboBox current text, which is a sensor
+                items.push_back(item);
+                sensors.push_back(qobject_cast<QComboBox*>(widget)->currentText()); // Gets ComboBox current text, which is a sensor
+                if (mSensors->isCameraSensor(sensors.last()))
+                    cameras++;
+            }
+        }
 
-                arguments = mSensors->roslaunchManager(item, sensor, ballDiameter);
+        // Launch nodes according to the user-selected sensors. With several cameras each one needs its own intrinsics
+        for (int i=0; i < items.size(); i++)
+        {
+            arguments = mSensors->roslaunchManager(items[i], sensors[i], ballDiameter, cameras == 1);
 
-                qDebug() << "Launching with:" << program << arguments.join(" ");
+            qDebug() << "Launching with:" << program << arguments.join(" ");
 
-                processes.push_back(new QProcess(this));
-                connect(processes.last(), SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(NodeFinished(int, QProcess::ExitStatus)));
+            processes.push_back(new QProcess(this));
+            connect(processes.last(), SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(NodeFinished(int, QProcess::ExitStatus)));
 
-                processes.last()->start(program, arguments);
-            }
+            processes.last()->start(program, arguments);
         }
 
         launchedNodes = mSensors->getLaunchedNodes();
@@ -82,7 +82,8 @@ void SupportedSensors::addTreeChilds(QTreeWidgetItem *item, const QString sensor
         makeChild(item, ask_IP, 0);
     else if (sensorID == supportedSensors[2]) //Point Grey FL3-GE-28S4-C
     {
-        // Nothing for now...IP is changed through FlyCap2 software
+        // IP is changed through FlyCap2 software, the serial number picks the camera when there are several
+        makeChild(item, "Serial Number", 0);
     }
     else if (sensorID == supportedSensors[3]) //SwissRanger SR4000_(Ethernet)
         makeChild(item, ask_IP, 0);
@@ -127,9 +128,10 @@ void SupportedSensors::makeChild (QTreeWidgetItem *parent, const QString text, i
    @param[in] item QTreeWidgetItem
    @param[in] sensor name of the sensor
    @param[in] ballDiameter diameter of the ball inserted in the Options window
+   @param[in] singleCamera true if this is the only camera launched, which may then use the default intrinsics
    @return roslaunch_arg a list of the roslaunch arguments
  */
-QStringList SupportedSensors::roslaunchManager(QTreeWidgetItem * item, QString sensor, double ballDiameter)
+QStringList SupportedSensors::roslaunchManager(QTreeWidgetItem * item, QString sensor, double ballDiameter, bool singleCamera)
 {
     QString ball_diameter = "ball_diameter:=" + QString::number(ballDiameter);
     QString node_name = "node_name:=";
@@ -147,12 +149,23 @@ QStringList SupportedSensors::roslaunchManager(QTreeWidgetItem * item, QString s
             launchedNodes.push_back(supportedSensorsNodes[i] + "_" + QString::number(sensorCounter[i]));
             node_name += launchedNodes.last();
 
-            if (item->childCount())
+            if (supportedCamera[i])
             {
-                itemchild = item->child(0);
-                sensorIP += itemchild->text(1);
+                // An empty serial number launches the driver on the first camera found
+                if (item->childCount() && !item->child(0)->text(1).isEmpty())
+                    roslaunch_params << "serial:=" + item->child(0)->text(1);
+                roslaunch_params << QString("single_camera:=") + (singleCamera ? "true" : "false");
+                roslaunch_params << node_name;
+            }
+            else
+            {
+                if (item->childCount())
+                {
+                    itemchild = item->child(0);
+                    sensorIP += itemchild->text(1);
+                }
+                roslaunch_params << sensorIP << node_name;
             }
-            roslaunch_params << sensorIP << node_name;
             isCamera.push_back(supportedCamera[i]);
         }
     }
@@ -166,6 +179,17 @@ QStringList SupportedSensors::roslaunchManager(QTreeWidgetItem * item, QString s
     return roslaunch_arg;
 }
 
+/**
+   @brief Checks if a supported sensor is a camera
+   @param[in] sensor name of the sensor
+   @return true if the sensor is a camera
+ */
+bool SupportedSensors::isCameraSensor(QString sensor)
+{
+    int i = supportedSensors.indexOf(sensor);
+    return i >= 0 && supportedCamera[i];
+}
+
 /**
    @brief Gets sensor names to display in the Rviz 3D visualizer
    @param void
@@ -0,0 +1,141 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  hsv_gate.cpp
+ \brief Colour gating of XYZRGB clouds by an HSV range, with a precomputed lookup table
+ \date   October, 2026
+*/
+
+#include "calibration_gui/hsv_gate.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+/**
+@brief RGB to HSV conversion of one colour, with the fixed point arithmetic of cv::cvtColor(COLOR_BGR2HSV) for 8 bit
+images, so the gate matches the thresholds tuned on the camera
+@param[in] r red
+@param[in] g green
+@param[in] b blue
+@param[out] h hue, 0-179
+@param[out] s saturation, 0-255
+@param[out] v value, 0-255
+@return void
+*/
+void rgbToHSV(uint8_t r, uint8_t g, uint8_t b, int& h, int& s, int& v)
+{
+    const int shift=12;
+    int vmin=std::min((int)r, std::min((int)g, (int)b));
+    v=std::max((int)r, std::max((int)g, (int)b));
+    int diff=v-vmin;
+
+    int sdiv= v ? (int)floor((255<<shift)/(1.0*v)+0.5) : 0;
+    int hdiv= diff ? (int)floor((180<<shift)/(6.0*diff)+0.5) : 0;
+    s=(diff*sdiv+(1<<(shift-1)))>>shift;
+
+    if(v==r)
+        h=g-b;
+    else if(v==g)
+        h=b-r+2*diff;
+    else
+        h=r-g+4*diff;
+    h=(h*hdiv+(1<<(shift-1)))>>shift;
+    if(h<0)
+        h+=180;
+}
+
+/**
+@brief HSVGate constructor, the default range is the one of the Point Grey detector
+@param[in] lowH lower hue
+@param[in] highH upper hue, below lowH for a range wrapping around red
+@param[in] lowS lower saturation
+@param[in] highS upper saturation
+@param[in] lowV lower value
+@param[in] highV upper value
+*/
+HSVGate::HSVGate(int lowH, int highH, int lowS, int highS, int lowV, int highV)
+{
+    setRange(lowH, highH, lowS, highS, lowV, highV);
+}
+
+/**
+@brief Sets the HSV range and rebuilds the lookup table (16M colours, done once)
+@param[in] lowH lower hue
+@param[in] highH upper hue, below lowH for a range wrapping around red
+@param[in] lowS lower saturation
+@param[in] highS upper saturation
+@param[in] lowV lower value
+@param[in] highV upper value
+@return void
+*/
+void HSVGate::setRange(int lowH, int highH, int lowS, int highS, int lowV, int highV)
+{
+    lut.assign(1<<21, 0);
+    for(int r=0; r<256; r++)
+        for(int g=0; g<256; g++)
+            for(int b=0; b<256; b++)
+            {
+                int h, s, v;
+                rgbToHSV(r, g, b, h, s, v);
+                bool hue= lowH<=highH ? (h>=lowH && h<=highH) : (h>=lowH || h<=highH);
+                if(hue && s>=lowS && s<=highS && v>=lowV && v<=highV)
+                {
+                    uint32_t i=(r<<16)|(g<<8)|b;
+                    lut[i>>3]|=1<<(i&7);
+                }
+            }
+}
+
+/**
+@brief Colour gating of a cloud. The points outside the range are set to NaN, so an organized cloud stays organized
+@param[in] cloud XYZRGB cloud
+@param[out] gated XYZ cloud with the same size as the input
+@return void
+*/
+void HSVGate::filter(const pcl::PointCloud<pcl::PointXYZRGB>& cloud, pcl::PointCloud<pcl::PointXYZ>& gated) const
+{
+    gated.header=cloud.header;
+    gated.width=cloud.width;
+    gated.height=cloud.height;
+    gated.is_dense=false;
+    gated.points.resize(cloud.points.size());
+
+    const float nan=numeric_limits<float>::quiet_NaN();
+    for(size_t i=0; i<cloud.points.size(); i++)
+    {
+        const pcl::PointXYZRGB& p=cloud.points[i];
+        pcl::PointXYZ& q=gated.points[i];
+        if(inside(p.r, p.g, p.b))
+        {
+            q.x=p.x;
+            q.y=p.y;
+            q.z=p.z;
+        }
+        else
+            q.x=q.y=q.z=nan;
+    }
+}
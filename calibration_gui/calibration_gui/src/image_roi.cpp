@@ -0,0 +1,109 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  image_roi.cpp
+ \brief Window of camera images around the predicted position of the ball
+ \date   October, 2026
+*/
+
+#include "calibration_gui/image_roi.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+@brief ImageROI constructor. The full frame is used until the first update
+@param[in] margin margin added to each side of the window, as a fraction of the ball size
+@param[in] fullInterval frames between full frame searches, 0 to only search the full frame when the ball is lost
+*/
+ImageROI::ImageROI(double margin, int fullInterval)
+{
+    this->margin=margin;
+    this->fullInterval=fullInterval;
+    reset();
+}
+
+/**
+@brief Drops the track, so the next frame is searched in full
+@return void
+*/
+void ImageROI::reset()
+{
+    ball=cv::Rect();
+    motion=cv::Point2d(0, 0);
+    frames=0;
+}
+
+/**
+@brief Window to search in the next frame
+@param[in] image size of the image
+@return cv::Rect window, the full image if there is no track or a full search is due
+*/
+cv::Rect ImageROI::window(const cv::Size& image)
+{
+    cv::Rect full(0, 0, image.width, image.height);
+    frames++;
+    if(!tracking() || (fullInterval>0 && frames>=fullInterval))
+    {
+        frames=0;
+        return full;
+    }
+
+    double cx=ball.x+ball.width/2.0+motion.x;
+    double cy=ball.y+ball.height/2.0+motion.y;
+    double hw=ball.width/2.0+margin*ball.width+std::fabs(motion.x);
+    double hh=ball.height/2.0+margin*ball.height+std::fabs(motion.y);
+
+    int u0=std::max((int)std::floor(cx-hw), 0);
+    int v0=std::max((int)std::floor(cy-hh), 0);
+    int u1=std::min((int)std::ceil(cx+hw), image.width);
+    int v1=std::min((int)std::ceil(cy+hh), image.height);
+    if(u1<=u0 || v1<=v0)
+    {
+        frames=0;
+        return full;
+    }
+    return cv::Rect(u0, v0, u1-u0, v1-v0);
+}
+
+/**
+@brief Tracks a detected ball, or drops the track if it was not detected
+@param[in] detected bounding box of the detected ball in the full image, empty if there was no detection
+@return void
+*/
+void ImageROI::update(const cv::Rect& detected)
+{
+    if(detected.area()<=0)
+    {
+        reset();
+        return;
+    }
+
+    if(tracking())
+        motion=cv::Point2d(detected.x+detected.width/2.0-(ball.x+ball.width/2.0),
+                           detected.y+detected.height/2.0-(ball.y+ball.height/2.0));
+    ball=detected;
+}
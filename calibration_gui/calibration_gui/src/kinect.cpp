@@ -34,6 +34,12 @@
 
  #include "calibration_gui/kinect.h"
  #include "calibration_gui/visualization_rviz_kinect.h"
+ #include "calibration_gui/sphere_detection.h"
+ #include "calibration_gui/sphere_ransac.h"
+ #include "calibration_gui/frame_budget.h"
+ #include "calibration_gui/organized_roi.h"
+ #include "calibration_gui/depth_candidates.h"
+ #include <pcl/common/io.h>
 
 // TF
  #include <tf/transform_broadcaster.h>
@@ -42,6 +48,13 @@
 
 ros::Publisher markers_pub;
 ros::Publisher sphereCenter_pub;
+ros::Publisher sphereDetection_pub;
+ros::Publisher timing_pub;
+SphereRansac ransac(0);
+// Coarse grid of the sphere search, 0 to search only at the fine level
+double coarseLeaf = 0.03;
+// Voxel size of 5 mm, up to 2 cm when the frames take longer than the budget
+FrameBudget budget(30, 0.8, 100, 10000, 0.005, 0.02);
 
 
 /**
@@ -58,18 +71,17 @@ void writeFile(Eigen::VectorXf sphereCoeffsRefined)
 
 /**
    @brief Detection of the ball on the Kinect data
-   @param[in] Kinect_cloud point cloud from the Kinect
-   @return void
+   @param[in] Kinect_cloud point cloud from the Kinect (the full frame, a window or a candidate blob), not copied
+   @param[out] sphere center and radius of the detected ball
+   @param[out] detection detected ball, not valid if the ball was not found
+   @return true if the ball was detected
  */
-void sphereDetection(pcl::PointCloud<pcl::PointXYZ> Kinect_cloud)
+bool sphereDetection(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &Kinect_cloud, double sphere[4], calibration_gui::SphereDetection &detection)
 {
 
 	ros::Time start = ros::Time::now();
 
-	geometry_msgs::PointStamped sphereCenter;
-	sphereCenter.point.x = -999;
-	sphereCenter.point.y = -999;
-	sphereCenter.point.z = -999;
+	invalidDetection(detection);
 
   // Ball detection methods tried =============================================
 
@@ -205,8 +217,6 @@ void sphereDetection(pcl::PointCloud<pcl::PointXYZ> Kinect_cloud)
 	/* METHOD #3 ================================================================
 	 * Detects the ball up to 3 meters, fast. Optimized Method #1
 	 */
-	pcl::PointCloud<pcl::PointXYZ>::Ptr Kinect_cloudPtr (new pcl::PointCloud<pcl::PointXYZ>(Kinect_cloud));
-
 	pcl::PointCloud<pcl::PointXYZ>::Ptr Kinect_cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>);
 
 	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_p (new pcl::PointCloud<pcl::PointXYZ>);
@@ -214,53 +224,85 @@ void sphereDetection(pcl::PointCloud<pcl::PointXYZ> Kinect_cloud)
 	//std::cerr << "PointCloud before filtering: " << Kinect_cloudPtr->width * Kinect_cloudPtr->height << " data points." << std::endl;
 
 	pcl::VoxelGrid<pcl::PointXYZ> sor;
-	sor.setInputCloud (Kinect_cloudPtr);
 	sor.setFilterFieldName ("z");
 	sor.setFilterLimits (0, 5);
-	sor.setLeafSize (0.005f, 0.005f, 0.005f);
+	ransac.setRadius(BALL_DIAMETER/2);
+
+	// Coarse level: the sphere is searched on a coarse grid, and only the points near it go through the fine level.
+	// A far ball covers only a few coarse voxels, so when the coarse grid is too small or has no sphere the whole cloud
+	// goes through the fine level, as in the single level search
+	pcl::PointCloud<pcl::PointXYZ>::ConstPtr fine_input = Kinect_cloud;
+	if(coarseLeaf > budget.leafSize())
+	{
+		pcl::PointCloud<pcl::PointXYZ>::Ptr coarse (new pcl::PointCloud<pcl::PointXYZ>);
+		sor.setInputCloud (Kinect_cloud);
+		sor.setLeafSize (coarseLeaf, coarseLeaf, coarseLeaf);
+		sor.filter (*coarse);
+
+		if(coarse->size() >= COARSE_MIN_POINTS)
+		{
+			ransac.setThreshold(max(SPHERE_THRESHOLD, coarseLeaf/4));
+			ransac.setInputCloud(*coarse);
+			ransac.setMaxIterations(budget.iterations(coarse->size()));
+			double coarseSphere[4];
+			vector<int> coarseInliers;
+			ros::WallTime coarseStart = ros::WallTime::now();
+			bool coarseFound = ransac.segment(coarseSphere, coarseInliers);
+			budget.ransacDone(coarse->size(), ransac.iterations(), (ros::WallTime::now() - coarseStart).toSec());
+
+			if(coarseFound)
+			{
+				pcl::PointCloud<pcl::PointXYZ>::Ptr shell (new pcl::PointCloud<pcl::PointXYZ>);
+				sphereShell(*Kinect_cloud, coarseSphere, BALL_DIAMETER/2, coarseLeaf, *shell);
+				fine_input = shell;
+			}
+		}
+	}
+
+	sor.setInputCloud (fine_input);
+	sor.setLeafSize (budget.leafSize(), budget.leafSize(), budget.leafSize());
 	sor.filter (*Kinect_cloud_filtered);
 
 	//std::cerr << "PointCloud after filtering: " << Kinect_cloud_filtered->width * Kinect_cloud_filtered->height << " data points." << std::endl;
 
-	pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients ());
-	pcl::PointIndices::Ptr inliers (new pcl::PointIndices ());
-
-	// Create the segmentation object
-	pcl::SACSegmentation<pcl::PointXYZ> seg;
-	// Optional
-	seg.setOptimizeCoefficients (true);
-	// Mandatory
-	seg.setModelType (pcl::SACMODEL_SPHERE);
-	seg.setMethodType (pcl::SAC_RANSAC);
-	seg.setMaxIterations (10000);
-	seg.setDistanceThreshold (0.0070936);
-	seg.setProbability(0.99);
-	seg.setRadiusLimits (BALL_DIAMETER/2-0.05, BALL_DIAMETER/2+0.05);
-	seg.setInputCloud (Kinect_cloud_filtered);
-	seg.segment (*inliers, *coefficients);
+	// Known radius RANSAC, the radius returned is fitted freely to the inliers to verify the ball size
+	ransac.setThreshold(SPHERE_THRESHOLD);
+	ransac.setInputCloud(*Kinect_cloud_filtered);
+	ransac.setMaxIterations(budget.iterations(Kinect_cloud_filtered->size()));
+	vector<int> inliers;
+	ros::WallTime ransacStart = ros::WallTime::now();
+	bool found = ransac.segment(sphere, inliers);
+	budget.ransacDone(Kinect_cloud_filtered->size(), ransac.iterations(), (ros::WallTime::now() - ransacStart).toSec());
 
 	ros::Time end = ros::Time::now();
 
-	cout << "Ball detection time filtered: " <<  (end - start).toNSec() * 1e-6 << " msec"  << endl;
-
-	cout << *coefficients << endl;
+	cout << "Ball detection time filtered: " <<  (end - start).toNSec() * 1e-6 << " msec, " << ransac.hypotheses() << " hypotheses" << endl;
 
-	if(inliers->indices.size ()>0)
+	if(found)
 	{
-
-		if (coefficients->values[3]<BALL_DIAMETER/2 + 0.05*BALL_DIAMETER/2 && coefficients->values[3]>BALL_DIAMETER/2 - 0.05*BALL_DIAMETER/2)
+		if (sphere[3]<BALL_DIAMETER/2 + 0.05*BALL_DIAMETER/2 && sphere[3]>BALL_DIAMETER/2 - 0.05*BALL_DIAMETER/2)
 		{
-			sphereCenter.point.x = coefficients->values[0];
-			sphereCenter.point.y = coefficients->values[1];
-			sphereCenter.point.z = coefficients->values[2];
-
+			sphereDetectionFromInliers(*Kinect_cloud_filtered, inliers, sphere, BALL_DIAMETER/2, detection);
 
-			cout << "Accepted: " << *coefficients << endl;
+			cout << "Accepted: " << sphere[0] << ", " << sphere[1] << ", " << sphere[2] << ", " << sphere[3] << endl;
 		}
 	}
   // Ball detection ends here ==================================================
 
-	sphereCenter.header.stamp = ros::Time::now();
+	return detection.valid;
+}
+
+/**
+   @brief Publishes the ball detected on a frame
+   @param[in] detection detected ball, not valid if the ball was not found
+   @return void
+ */
+void publishDetection(calibration_gui::SphereDetection &detection)
+{
+	detection.header.stamp = ros::Time::now();
+	sphereDetection_pub.publish(detection);
+
+	geometry_msgs::PointStamped sphereCenter = detectionCentroid(detection);
 	sphereCenter_pub.publish(sphereCenter);
 
 	pcl::PointXYZ center;
@@ -271,7 +313,6 @@ void sphereDetection(pcl::PointCloud<pcl::PointXYZ> Kinect_cloud)
 	visualization_msgs::MarkerArray targets_markers;
 	targets_markers.markers = createTargetMarkers(center);
 	markers_pub.publish(targets_markers);
-
 }
 
 /**
@@ -291,10 +332,56 @@ int main(int argc, char **argv)
 	cout << "Node namespace:" << node_ns << endl;
 	cout << "Ball diameter:" << BALL_DIAMETER << endl;
 
+	// Threads of the sphere RANSAC, 0 for one per core
+	int ransacThreads = 0;
+	n.getParam("ransacThreads", ransacThreads);
+	ransac.setThreads(ransacThreads);
+
+	// Frame rate of the sensor, sets the time budget of each frame
+	double sensorRate = 30;
+	n.getParam("sensorRate", sensorRate);
+	budget.setRate(sensorRate);
+
+	// Voxel size of the coarse level of the sphere search, 0 for a single level
+	n.getParam("coarseLeaf", coarseLeaf);
+
+	// Window around the last detection, as a fraction of the ball size. Negative to always search the full frame
+	double roiMargin = 0.5;
+	n.getParam("roiMargin", roiMargin);
+	OrganizedROI roi(roiMargin);
+
+	// Sphere fitting first on the depth blobs with the size of the ball, then on the whole window if none has it
+	bool blobCandidates = true;
+	n.getParam("blobCandidates", blobCandidates);
+	DepthBlobDetector blobs(BALL_DIAMETER);
+
+	// Frames between whole window searches when no blob has the ball size and the ball is not tracked, 1 for every frame
+	int fallbackInterval = 10;
+	n.getParam("fallbackInterval", fallbackInterval);
+	int framesWithoutFallback = 0;
+
 	markers_pub = n.advertise<visualization_msgs::MarkerArray>( "BallDetection", 1000);
 	sphereCenter_pub = n.advertise<geometry_msgs::PointStamped>("SphereCentroid",1000);
+	sphereDetection_pub = n.advertise<calibration_gui::SphereDetection>("SphereDetection",1000);
+	timing_pub = n.advertise<calibration_gui::DetectionTiming>("DetectionTiming",10);
+
+	// Optional colour gate, only the points with the colour of the ball (HSV range of the Point Grey detector) are searched
+	bool colorGate = false;
+	n.getParam("colorGate", colorGate);
+	HSVGate *gate = NULL;
+	if(colorGate)
+	{
+		int lowH = 142, highH = 179, lowS = 45, highS = 255, lowV = 0, highV = 255;
+		n.getParam("lowH", lowH);
+		n.getParam("highH", highH);
+		n.getParam("lowS", lowS);
+		n.getParam("highS", highS);
+		n.getParam("lowV", lowV);
+		n.getParam("highV", highV);
+		gate = new HSVGate(lowH, highH, lowS, highS, lowV, highV);
+	}
 
-	kinect cloud(node_ns);
+	kinect cloud(node_ns, gate);
 
 	tf::Transform transform;
 	tf::TransformBroadcaster tf_broadcast;
@@ -303,17 +390,62 @@ int main(int argc, char **argv)
 
 	ros::Rate loop_rate(30);
 
+	// last cloud processed, the same frame is not searched twice
+	pcl::PointCloud<pcl::PointXYZ>::ConstPtr last_cloud;
+
 	while( ros::ok() )
 	{
 		tf_broadcast.sendTransform(tf::StampedTransform(transform, ros::Time::now(),"my_frame","camera_rgb_optical_frame"));
 
-		if(cloud.cloud.points.size())
+		if(cloud.cloud && cloud.cloud != last_cloud && cloud.cloud->points.size())
 		{
-			sphereDetection(cloud.cloud);
+			last_cloud = cloud.cloud;
+			budget.start();
+
+			// Only the window around the last detection goes through the filters and RANSAC
+			pcl::PointCloud<pcl::PointXYZ>::ConstPtr input = roiMargin >= 0 ? roi.crop(last_cloud) : last_cloud;
+
+			calibration_gui::SphereDetection detection;
+			invalidDetection(detection);
+			double sphere[4];
+			bool found = false;
+			vector<SphereCandidate> candidates;
+			if(blobCandidates)
+			{
+				// Candidates are tried from the best size match, until one of them is a sphere
+				blobs.detect(*input, candidates);
+				for(int i=0; i<candidates.size() && !found; i++)
+				{
+					pcl::PointCloud<pcl::PointXYZ>::Ptr candidate (new pcl::PointCloud<pcl::PointXYZ>);
+					pcl::copyPointCloud(*input, candidates[i].indices, *candidate);
+					found = sphereDetection(candidate, sphere, detection);
+				}
+			}
+			// Without candidates the whole window is searched. With them, only when no blob has the ball size: a ball
+			// touching its stand or a hand is flood filled into a larger blob, and an occluded one into a smaller blob.
+			// Out of tracking that is the whole frame, so it is then only searched every fallbackInterval frames
+			if(!found && (!blobCandidates || (candidates.empty() && (roi.valid() || ++framesWithoutFallback >= fallbackInterval))))
+			{
+				framesWithoutFallback = 0;
+				invalidDetection(detection);
+				found = sphereDetection(input, sphere, detection);
+			}
+			publishDetection(detection);
+
+			budget.finish();
+			calibration_gui::DetectionTiming timing = budget.timing();
+			timing.header.stamp = ros::Time::now();
+			timing_pub.publish(timing);
+
+			if(found && roiMargin >= 0)
+				roi.update(*last_cloud, sphere, sphere[3]);
+			else
+				roi.reset();
 		}
 		ros::spinOnce();
 		loop_rate.sleep();
 	}
 
+	delete gate;
 	return 0;
 }
@@ -0,0 +1,233 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  laser_conversion.cpp
+ \brief Scan to cartesian conversion shared by the SICK LMS and SICK LD-MRS ball detectors
+ \date   October, 2026
+*/
+
+#include "calibration_gui/laser_conversion.h"
+#include <cmath>
+
+/**
+@brief LaserDirectionTable constructor. The table is empty until the first call to configure
+*/
+LaserDirectionTable::LaserDirectionTable()
+{
+    angle_min=0;
+    angle_increment=0;
+    rotation=0;
+    dir_z=0;
+    planar=1;
+}
+
+/**
+@brief Builds the direction table for the configuration of the incoming scan.
+Nothing is done if the table was already built for the same configuration
+@param[in] scan laser scan
+@param[in] rot rotation of the scan layer in relation to the XY plane [deg]
+@return true if the table was (re)built, false if it was reused
+*/
+bool LaserDirectionTable::configure(const sensor_msgs::LaserScan& scan, double rot)
+{
+    size_t s=scan.ranges.size();
+    if(s==dir_x.size() && scan.angle_min==angle_min && scan.angle_increment==angle_increment && rot==rotation)
+        return false;
+
+    angle_min=scan.angle_min;
+    angle_increment=scan.angle_increment;
+    rotation=rot;
+
+    planar=cos(rot*M_PI/180);
+    dir_z=sin(rot*M_PI/180);
+
+    dir_x.resize(s);
+    dir_y.resize(s);
+    theta.resize(s);
+    for(size_t n=0; n<s; n++)
+    {
+        double angle = angle_min + n*angle_increment;
+        dir_x[n]=planar*cos(angle);
+        dir_y[n]=planar*sin(angle);
+        theta[n]=atan2(sin(angle),cos(angle));
+    }
+
+    x.resize(s);
+    y.resize(s);
+    z.resize(s);
+    range.resize(s);
+    return true;
+}
+
+/**
+@brief Converts a laser scan to points, using the direction table built by configure.
+The theta and range of each point are taken from the table, so they do not need to be recovered from x and y
+@param[in] scan laser scan
+@param[out] points converted points
+@return void
+*/
+void LaserDirectionTable::convert(const sensor_msgs::LaserScan& scan, vector<PointPtr>& points)
+{
+    points.clear();
+    size_t s=scan.ranges.size();
+    if(s!=dir_x.size())
+        configure(scan, rotation);
+    if(s==0)
+        return;
+
+    // Plain multiplies over contiguous buffers, vectorized by the compiler
+    const float* r=&scan.ranges[0];
+    const double* dx=&dir_x[0];
+    const double* dy=&dir_y[0];
+    double* px=&x[0];
+    double* py=&y[0];
+    double* pz=&z[0];
+    double* pr=&range[0];
+    for(size_t n=0; n<s; n++)
+    {
+        px[n]=r[n]*dx[n];
+        py[n]=r[n]*dy[n];
+        pz[n]=r[n]*dir_z;
+        pr[n]=r[n]*planar;
+    }
+
+    points.reserve(s);
+    for(size_t n=0; n<s; n++)
+    {
+        PointPtr p(new Point);
+
+        p->x=px[n];
+        p->y=py[n];
+        p->z=pz[n];
+        p->theta=theta[n];
+        p->range=pr[n];
+        p->label=n;
+        p->iteration=n+1;
+        p->cluster_id=1;
+
+        points.push_back(p);
+    }
+}
+
+/**
+@brief ScanAccumulator constructor
+@param[in] window number of scans merged, 1 disables the accumulation
+@param[in] tolerance range jump that restarts a beam [m]
+*/
+ScanAccumulator::ScanAccumulator(int window, double tolerance)
+{
+    W=window<1 ? 1 : window;
+    this->tolerance=tolerance;
+    head=0;
+}
+
+/**
+@brief Changes the window size, dropping the scans already accumulated
+@param[in] window number of scans merged, 1 disables the accumulation
+@return void
+*/
+void ScanAccumulator::setWindow(int window)
+{
+    W=window<1 ? 1 : window;
+    reset(0);
+}
+
+/**
+@brief Clears the window and sizes the buffers for the number of beams
+@param[in] beams number of beams of the scan
+@return void
+*/
+void ScanAccumulator::reset(size_t beams)
+{
+    head=0;
+    history.assign(beams*W, 0);
+    sum.assign(beams, 0);
+    count.assign(beams, 0);
+}
+
+/**
+@brief Adds a scan to the window and returns the merged scan.
+The work is one update per beam, independent of the window size. A scan with the sequence number and stamp of the
+last one is not added again, so it can't be averaged with itself
+@param[in] scan laser scan, from the same sensor as the previous ones
+@return const sensor_msgs::LaserScan& scan with the mean range of each beam over its stationary window
+*/
+const sensor_msgs::LaserScan& ScanAccumulator::add(const sensor_msgs::LaserScan& scan)
+{
+    size_t s=scan.ranges.size();
+    if(W==1)
+    {
+        count.assign(s, 1);
+        return scan;
+    }
+
+    if(!count.empty() && scan.header.seq==merged.header.seq && scan.header.stamp==merged.header.stamp)
+        return merged;
+
+    if(s!=count.size() || scan.angle_min!=merged.angle_min || scan.angle_increment!=merged.angle_increment)
+        reset(s);
+
+    merged.header=scan.header;
+    merged.angle_min=scan.angle_min;
+    merged.angle_max=scan.angle_max;
+    merged.angle_increment=scan.angle_increment;
+    merged.time_increment=scan.time_increment;
+    merged.scan_time=scan.scan_time;
+    merged.range_min=scan.range_min;
+    merged.range_max=scan.range_max;
+    merged.ranges.resize(s);
+
+    for(size_t n=0; n<s; n++)
+    {
+        float r=scan.ranges[n];
+        float* slot=&history[n*W];
+
+        if(!std::isfinite(r) || (count[n]>0 && fabs(r-sum[n]/count[n])>tolerance))
+        {
+            // invalid range or the target moved, restart the beam
+            sum[n]=0;
+            count[n]=0;
+        }
+
+        if(std::isfinite(r))
+        {
+            // every beam is written once per scan, so the oldest range of a full window is in the head slot
+            if(count[n]==W)
+                sum[n]-=slot[head];
+            else
+                count[n]++;
+            slot[head]=r;
+            sum[n]+=r;
+            merged.ranges[n]=sum[n]/count[n];
+        }
+        else
+            merged.ranges[n]=r;
+    }
+
+    head=(head+1)%W;
+    return merged;
+}
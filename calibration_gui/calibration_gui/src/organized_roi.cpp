@@ -0,0 +1,135 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  organized_roi.cpp
+ \brief Pixel window cropping of organized point clouds around the last detected ball
+ \date   October, 2026
+*/
+
+#include "calibration_gui/organized_roi.h"
+#include <algorithm>
+
+/**
+@brief OrganizedROI constructor. The full frame is used until the first update
+@param[in] margin margin added to each side of the window, as a fraction of the ball size in pixels
+*/
+OrganizedROI::OrganizedROI(double margin)
+{
+    this->margin=margin;
+    reset();
+}
+
+/**
+@brief Drops the window, so the next frame is searched in full
+@return void
+*/
+void OrganizedROI::reset()
+{
+    u0=v0=0;
+    u1=v1=0;
+}
+
+/**
+@brief Crops the window out of an organized cloud, before any filtering.
+The cropped cloud is organized too (width x height of the window)
+@param[in] cloud organized point cloud
+@return pcl::PointCloud<pcl::PointXYZ>::ConstPtr cropped cloud, or the input cloud itself (not copied) if there is no window
+*/
+pcl::PointCloud<pcl::PointXYZ>::ConstPtr OrganizedROI::crop(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr& cloud) const
+{
+    if(!valid() || cloud->height<=1 || u1>(int)cloud->width || v1>(int)cloud->height)
+        return cloud;
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr roi(new pcl::PointCloud<pcl::PointXYZ>);
+    roi->header=cloud->header;
+    roi->width=u1-u0;
+    roi->height=v1-v0;
+    roi->is_dense=false;
+    roi->points.resize(roi->width*roi->height);
+
+    for(int v=v0; v<v1; v++)
+    {
+        const pcl::PointXYZ* row=&cloud->points[v*cloud->width];
+        std::copy(row+u0, row+u1, roi->points.begin()+(v-v0)*roi->width);
+    }
+    return roi;
+}
+
+/**
+@brief Sets the window around a detected ball.
+Only the current window (or the full frame, if there is none) is scanned for the pixels close to the ball
+@param[in] cloud organized cloud the ball was detected in (the full frame, not the cropped one)
+@param[in] center center of the detected ball
+@param[in] radius radius of the detected ball
+@return true if the window was set, false if the cloud is not organized or no pixel hit the ball
+*/
+bool OrganizedROI::update(const pcl::PointCloud<pcl::PointXYZ>& cloud, const double center[3], double radius)
+{
+    if(cloud.height<=1)
+    {
+        reset();
+        return false;
+    }
+
+    int su0=0, sv0=0, su1=cloud.width, sv1=cloud.height;
+    if(valid() && u1<=(int)cloud.width && v1<=(int)cloud.height)
+    {
+        su0=u0; sv0=v0; su1=u1; sv1=v1;
+    }
+
+    // pixels within a slightly enlarged sphere, NaN points fail the comparison
+    double limit=1.2*radius*1.2*radius;
+    int bu0=su1, bv0=sv1, bu1=su0-1, bv1=sv0-1;
+    for(int v=sv0; v<sv1; v++)
+    {
+        const pcl::PointXYZ* row=&cloud.points[v*cloud.width];
+        for(int u=su0; u<su1; u++)
+        {
+            double dx=row[u].x-center[0], dy=row[u].y-center[1], dz=row[u].z-center[2];
+            if(dx*dx+dy*dy+dz*dz<limit)
+            {
+                bu0=std::min(bu0, u);
+                bu1=std::max(bu1, u);
+                bv0=std::min(bv0, v);
+                bv1=std::max(bv1, v);
+            }
+        }
+    }
+
+    if(bu1<bu0 || bv1<bv0)
+    {
+        reset();
+        return false;
+    }
+
+    int m=(int)(margin*std::max(bu1-bu0+1, bv1-bv0+1));
+    u0=std::max(bu0-m, 0);
+    v0=std::max(bv0-m, 0);
+    u1=std::min(bu1+1+m, (int)cloud.width);
+    v1=std::min(bv1+1+m, (int)cloud.height);
+    return true;
+}
@@ -36,16 +36,36 @@
 //Marker's publisher
 ros::Publisher ballCentroidCam_pub;
 ros::Publisher ballCentroidCamPnP_pub;
+ros::Publisher ballDetectionCam_pub;
 image_transport::Publisher ballCentroidImage_pub;
 
 Mat CameraMatrix1, disCoeffs1;
-
-int lowH;
-int highH;
-int lowS;
-int highS;
-int lowV;
-int highV;
+Mat undistortMap1, undistortMap2; // undistortion tables, built once for the image size
+bool undistortContour = true;     // detect on the raw image and undistort only the ball contour
+bool fusedSegmentation = true;    // LUT threshold and separable morphology instead of the OpenCV chain
+BallSegmenter segmenter;
+ImageROI roi;                     // window around the predicted ball position
+double roiMargin = 0.5;           // negative to always search the full frame
+boost::mutex roiMutex;            // roi is read by the segmentation stage and updated by the detection stage
+bool headless = false;            // no windows, the HSV range is read from the parameters
+
+// latency of each stage of a frame, reported on the latency topic of the camera. The stamp of the driver is the exposure
+// time plus the shortest transfer delay it has seen, so the stages from the stamp are the delay above that minimum
+LatencyHistogram stampToReceive("detector: receive delay above minimum");
+LatencyHistogram receiveToSegmented("detector: receive to segmented");
+LatencyHistogram segmentedToDetected("detector: segmented to detected");
+LatencyHistogram detectedToPublished("detector: detected to published");
+LatencyHistogram stampToCentroid("detector: centroid publish delay above minimum");
+
+// HSV range, set by the trackbars or the parameters and copied to hsvRange for the segmentation stage
+int lowH = 142;
+int highH = 179;
+int lowS = 45;
+int highS = 255;
+int lowV = 0;
+int highV = 255;
+int hsvRange[6] = {142, 179, 45, 255, 0, 255};
+boost::mutex tunablesMutex;
 int valMinDist;
 int valC;
 int valA;
@@ -69,15 +89,6 @@ void CreateTrackbarsAndWindows ()
 	char key = waitKey(1);
 
 	/* Trackbars for Hue, Saturation and Value (HSV) in "Camera 1" window */
-	lowH = 142;
-	highH = 179;
-
-	lowS = 45;
-	highS = 255;
-
-	lowV = 0;
-	highV = 255;
-
 	valC = 200;
 
 	valA = 150;
@@ -114,55 +125,154 @@ void CreateTrackbarsAndWindows ()
 }
 
 /**
-   @brief Image processing and ball detection
-   @param[in] img image captured by the Point Grey camera
+   @brief Reads the HSV range for the segmentation stage, from the trackbars or from the parameters.
+   The parameters are cached, so they can be polled every frame and changed at run time with rosparam
+   @param[in] n node handle of the private parameters
+   @param[in] readParams true to read the parameters, false to use the trackbar values
+   @return void
+ */
+void UpdateTunables(ros::NodeHandle &n, bool readParams)
+{
+	static const char *names[6] = {"lowH", "highH", "lowS", "highS", "lowV", "highV"};
+	int *values[6] = {&lowH, &highH, &lowS, &highS, &lowV, &highV};
+
+	boost::mutex::scoped_lock lock(tunablesMutex);
+	for(int i=0; i<6; i++)
+	{
+		if(readParams)
+			n.getParamCached(names[i], *values[i]);
+		hsvRange[i] = *values[i];
+	}
+}
+
+/**
+   @brief Segmentation stage of the pipeline: undistortion, window and binary image of the ball colour
+   @param[in,out] frame frame with the captured image, to which the binary image is added
    @return void
  */
-void ImageProcessing(Mat &img)
+void ImageProcessing(CameraFrame &frame)
 {
 	Mat imgHSV;
 	Mat unImg;
 	Mat imgBinary;
-
-	// capture loop
-
-	//imshow("Camera", img);         // untouched image
+	Mat &img = frame.image;
 
 	// =========================================================================
 	// Pre-processing
 	// =========================================================================
 
-	// Convert the captured image frame BGR to HSV
-	undistort(img,unImg,CameraMatrix1,disCoeffs1);
-	cvtColor(unImg, imgHSV, COLOR_BGR2HSV);
-
-	// Threshold the image
-	inRange(imgHSV, Scalar(lowH, lowS, lowV), Scalar(highH, highS, highV), imgBinary);
-
-	//morphological closing (fill small holes in the foreground)
-	dilate( imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
-	erode(imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
+	// Undistortion, either of the ball contour only (in PolygonalCurveDetection) or of the full frame with precomputed tables
+	if(undistortContour)
+		unImg = img;
+	else
+	{
+		if(undistortMap1.empty() || undistortMap1.size() != img.size())
+			initUndistortRectifyMap(CameraMatrix1, disCoeffs1, Mat(), CameraMatrix1, img.size(), CV_16SC2, undistortMap1, undistortMap2);
+		remap(img, unImg, undistortMap1, undistortMap2, INTER_LINEAR);
+	}
+	frame.image = unImg;
 
-	//morphological opening (remove small objects from the foreground)
-	erode(imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
-	dilate( imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
+	// Only the window around the predicted ball position is searched while the ball is tracked
+	if(roiMargin >= 0)
+	{
+		boost::mutex::scoped_lock lock(roiMutex);
+		frame.window = roi.window(unImg.size());
+	}
+	else
+		frame.window = Rect(0, 0, unImg.cols, unImg.rows);
+	Mat imgWindow = unImg(frame.window);
+	frame.imgColor = imgWindow;
 
-	GaussianBlur( imgBinary, imgBinary, Size(5, 5), 2, 2 );
+	int range[6];
+	{
+		boost::mutex::scoped_lock lock(tunablesMutex);
+		std::copy(hsvRange, hsvRange+6, range);
+	}
 
+	if(frame.bayer >= 0)
+	{
+		BayerImageProcessing(frame, range);
+		return;
+	}
 
+	if(fusedSegmentation)
+	{
+		// HSV threshold, closing and opening with a lookup table and separable filters
+		segmenter.setRange(range[0], range[1], range[2], range[3], range[4], range[5]);
+		imgBinary = segmenter.segment(imgWindow);
+	}
+	else
+	{
+		// Convert the captured image frame BGR to HSV
+		cvtColor(imgWindow, imgHSV, COLOR_BGR2HSV);
 
-	imshow("Binary Image", imgBinary);
+		// Threshold the image. A lower hue above the upper hue wraps around red, as in the fused segmentation
+		if(range[0] <= range[1])
+			inRange(imgHSV, Scalar(range[0], range[2], range[4]), Scalar(range[1], range[3], range[5]), imgBinary);
+		else
+		{
+			Mat imgWrapped;
+			inRange(imgHSV, Scalar(range[0], range[2], range[4]), Scalar(179, range[3], range[5]), imgBinary);
+			inRange(imgHSV, Scalar(0, range[2], range[4]), Scalar(range[1], range[3], range[5]), imgWrapped);
+			bitwise_or(imgBinary, imgWrapped, imgBinary);
+		}
 
-	// =====================================================================
-	// Circle detection
-	// Hough Circles or Polygonal Curve fitting algorithm, pick one
-	// =====================================================================
+		//morphological closing (fill small holes in the foreground)
+		dilate( imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
+		erode(imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
 
-	//HoughCircles(unImg, imgBinary);
+		//morphological opening (remove small objects from the foreground)
+		erode(imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
+		dilate( imgBinary, imgBinary, getStructuringElement(MORPH_RECT, Size(5, 5)) );
+	}
 
-	PolygonalCurveDetection(unImg, imgBinary);
+	// into a new image, the segmenter buffer is reused by the next frame while this one is in the detection stage
+	GaussianBlur( imgBinary, frame.imgBinary, Size(5, 5), 2, 2 );
+}
 
-	char key = waitKey(1);
+/**
+   @brief Segmentation of a Bayer image without demosaicing the full frame. The 2x2 quads of the window are segmented
+   at half resolution, then only the box around the blobs large enough to be the ball is demosaiced and segmented at
+   full resolution, so the contour is as precise as with a BGR image
+   @param[in,out] frame frame with the Bayer image and its window, whose window is replaced by the box around the ball
+   candidates (empty if there is none) and to which the binary image of the box is added
+   @param[in] range HSV range
+   @return void
+ */
+void BayerImageProcessing(CameraFrame &frame, const int range[6])
+{
+	const Mat &img = frame.image;
+	segmenter.setRange(range[0], range[1], range[2], range[3], range[4], range[5]);
+
+	// window on whole quads, so the pattern does not change
+	int x0 = frame.window.x & ~1, y0 = frame.window.y & ~1;
+	Rect window(x0, y0, (frame.window.x + frame.window.width - x0) & ~1, (frame.window.y + frame.window.height - y0) & ~1);
+
+	vector<vector<Point> > blobs;
+	findContours(segmenter.segmentBayer(img(window), frame.redX, frame.redY).clone(), blobs, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+
+	// minimum area of PolygonalCurveDetection, at half resolution
+	Rect box;
+	for(size_t i=0; i<blobs.size(); i++)
+		if(std::fabs(contourArea(blobs[i])) >= 1000/4.0)
+			box = box.area() > 0 ? (box | boundingRect(blobs[i])) : boundingRect(blobs[i]);
+
+	frame.imgBinary = Mat();
+	frame.imgColor = Mat();
+	frame.window = Rect();
+	if(box.area() == 0)
+		return;
+
+	// quads to pixels, with a margin for the morphology and the blur, on whole quads
+	int pad = 8;
+	Rect refine(window.x + 2*box.x - pad, window.y + 2*box.y - pad, 2*box.width + 2*pad, 2*box.height + 2*pad);
+	refine &= Rect(0, 0, img.cols & ~1, img.rows & ~1);
+
+	Mat bgr;
+	cvtColor(img(refine), bgr, frame.bayer);
+	GaussianBlur( segmenter.segment(bgr), frame.imgBinary, Size(5, 5), 2, 2 );
+	frame.imgColor = bgr;
+	frame.window = refine;
 }
 
 /**
@@ -201,28 +311,72 @@ void HoughDetection(const Mat &img, const Mat& imgBinary)
 
 
 /**
-   @brief Ball detection amd computation of its proprieties using approximated polygonal curves.
-   @param[in] img undistorted captured image
-   @param[in] imgBinary binary image for ball detection
+   @brief Sub-pixel edge points of a ball contour: each contour pixel is moved, along the gradient of the binary image,
+   to where the colour of the image crosses half way between the ball and the background
+   @param[in] frame frame with the BGR and binary images of the window
+   @param[in] contour contour of the ball in the image
+   @param[out] edges edge points in the image
+   @param[out] weights contrast of the edge points
+   @return void
+ */
+void SubpixelEdges( const CameraFrame &frame, const vector<Point> &contour, vector<Point2f> &edges, vector<double> &weights )
+{
+	const Mat &color = frame.imgColor;
+	const Mat &mask = frame.imgBinary;
+	edges.clear();
+	weights.clear();
+
+	for(size_t j=0; j<contour.size(); j++)
+	{
+		double x, y, weight;
+		if(subpixelEdge(color.ptr<uint8_t>(0), color.step, mask.ptr<uint8_t>(0), mask.step, mask.cols, mask.rows,
+		                contour[j].x - frame.window.x, contour[j].y - frame.window.y, x, y, weight))
+		{
+			edges.push_back(Point2f(x + frame.window.x, y + frame.window.y));
+			weights.push_back(weight);
+		}
+	}
+}
+
+/**
+   @brief Contour in undistorted pixel coordinates
+   @param[in] points contour found on the image
+   @param[out] undistorted contour without the lens distortion, the same points if the image was already undistorted
+   @return void
+ */
+void UndistortContour( const vector<Point2f> &points, vector<Point2f> &undistorted )
+{
+	// P = CameraMatrix1 keeps the undistorted points in pixels
+	if(undistortContour && !points.empty())
+		undistortPoints(points, undistorted, CameraMatrix1, disCoeffs1, noArray(), CameraMatrix1);
+	else
+		undistorted = points;
+}
+
+/**
+   @brief Detection stage of the pipeline: ball detection amd computation of its proprieties using approximated polygonal curves.
+   Hough Circles (HoughDetection) is the alternative
+   @param[in,out] frame frame with the binary image of the window, to which the detected ball is added
    @return void
  */
-void PolygonalCurveDetection( Mat &img, Mat &imgBinary)
+void PolygonalCurveDetection( CameraFrame &frame )
 {
 	vector<vector<Point> > contours;
 
 	/// Detect edges using canny
 	Mat imgCanny;
-	Canny( imgBinary, imgCanny, 100, 100*2, 3 ); // The canny threshold does not have significant effect on ball detection, it set at 100
+	if(!frame.imgBinary.empty())
+	{
+		Canny( frame.imgBinary, imgCanny, 100, 100*2, 3 ); // The canny threshold does not have significant effect on ball detection, it set at 100
 
-	//imshow("Canny", imgCanny);
+		//imshow("Canny", imgCanny);
 
-	findContours(imgCanny.clone(),contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+		findContours(imgCanny.clone(),contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE, frame.window.tl());
+	}
 
 	vector<Point> approx;
-	Mat dst = img.clone();
-	vector<double> areas;
 
-	pcl::PointXYZ centroid; // Point structure for centroid
+	pcl::PointXYZ &centroid = frame.centroid; // Point structure for centroid
 	/* The following lines make sure that position (0,0,0) is published when
 	   the ball is not detected (avoids publishing previous positions when the
 	   ball is no longer detected) */
@@ -230,7 +384,7 @@ void PolygonalCurveDetection( Mat &img, Mat &imgBinary)
 	centroid.y = -999;
 	centroid.z = -999;
 
-	pcl::PointXYZ centroidRadius; // Point structure for centroid
+	pcl::PointXYZ &centroidRadius = frame.centroidRadius; // Point structure for centroid
 	/* The following lines make sure that position (0,0,0) is published when
 	   the ball is not detected (avoids publishing previous positions when the
 	   ball is no longer detected) */
@@ -238,6 +392,11 @@ void PolygonalCurveDetection( Mat &img, Mat &imgBinary)
 	centroidRadius.y = -999;
 	centroidRadius.z = -999;
 
+	calibration_gui::SphereDetection &detection = frame.detection;
+	invalidDetection(detection);
+	frame.ball = Rect();
+	frame.contour.clear();
+
 	for(int i=0; i<contours.size(); i++)
 	{
 		approxPolyDP(Mat(contours[i]), approx, arcLength(Mat(contours[i]), true)*0.02,true);
@@ -250,6 +409,7 @@ void PolygonalCurveDetection( Mat &img, Mat &imgBinary)
 		// Detect and label circles
 		if(approx.size()>=6)
 		{
+			// aspect and area checks on the raw contour, so that only the contours that pass them are undistorted
 			double area = cv::contourArea(contours[i]);
 			cv::Rect r = cv::boundingRect(contours[i]);
 			int radius = (r.width/2 +r.width/2)/2;
@@ -257,48 +417,128 @@ void PolygonalCurveDetection( Mat &img, Mat &imgBinary)
 			if (abs(1 - ((double)r.width / r.height)) <= 0.2 && abs(1 - (area / (CV_PI * std::pow(radius, 2)))) <= 0.2
 			    && area>1000)
 			{
-				//cout<< "radius - "<< radius <<endl; // DEBUGGING
-
-				// Computing distnace from camera to center of detected circle
-				double Dist, f_avg;
+				// sub-pixel edges of the contour, undistorted
+				vector<Point2f> edges, contour;
+				vector<double> weights;
+				SubpixelEdges(frame, contours[i], edges, weights);
+				if(edges.size() < 6)
+					continue;
+				UndistortContour(edges, contour);
 
-				f_avg = (CameraMatrix1.at<double>(0,0) + CameraMatrix1.at<double>(1,1)) / 2;
+				//cout<< "radius - "<< radius <<endl; // DEBUGGING
 
-				Dist = (f_avg*(BALL_DIAMETER/(radius*2)));
-				std::stringstream s;
-				s<<Dist;
-				string str = s.str();
-				setLabel(dst, str, contours[i]);
+				double fx = CameraMatrix1.at<double>(0,0);
+				double fy = CameraMatrix1.at<double>(1,1);
+				double cx = CameraMatrix1.at<double>(0,2);
+				double cy = CameraMatrix1.at<double>(1,2);
+				double f_avg = (fx + fy) / 2;
+
+				// Ellipse fit of the edges weighted by their contrast, in normalized image coordinates
+				vector<double> x(contour.size()), y(contour.size());
+				for(size_t j=0; j<contour.size(); j++)
+				{
+					x[j] = (contour[j].x - cx) / fx;
+					y[j] = (contour[j].y - cy) / fy;
+				}
+				EllipseFit ellipse;
+				double center[3];
+				if(!fitEllipse(&x[0], &y[0], &weights[0], contour.size(), ellipse) || !sphereFromEllipse(ellipse, BALL_DIAMETER/2, center))
+					continue;
+
+				// projection of the ball center, which under perspective is not the ellipse center
+				centroid.x = fx*center[0]/center[2] + cx;
+				centroid.y = fy*center[1]/center[2] + cy;
+				centroid.z = ellipse.a*f_avg;
+
+				centroidRadius.x = center[0];
+				centroidRadius.y = center[1];
+				centroidRadius.z = center[2];
+
+				// Uncertainty of the center, from the residual of the ellipse fit, whose edges are the inliers
+				double covariance[3][3];
+				sphereCovarianceFromEllipse(ellipse, BALL_DIAMETER/2, covariance);
+				detection.valid = true;
+				detection.point.x = centroidRadius.x;
+				detection.point.y = centroidRadius.y;
+				detection.point.z = centroidRadius.z;
+				detection.inliers = ellipse.points;
+				detection.residual = ellipse.residual*f_avg;
+				setDetectionCovariance(detection, covariance);
+				frame.ball = cv::boundingRect(contours[i]);
+				frame.contour = contours[i];
+			}
+		}
+	}
 
-				centroid.x = r.x + radius;
-				centroid.y = r.y + radius;
-				centroid.z = radius;
+	if(roiMargin >= 0)
+	{
+		boost::mutex::scoped_lock lock(roiMutex);
+		roi.update(frame.ball);
+	}
+}
 
-				// Method based on circle radius =======================================
-				cv::Mat image_vector = (cv::Mat_<double>(3,1) << centroid.x, centroid.y, 1);
-				cv::Mat camera_vector = CameraMatrix1;
+/**
+   @brief Publishing stage of the pipeline: detected ball center and, if it is shown or subscribed, the image with the detected ball
+   @param[in,out] frame frame with the detected ball, whose image is replaced by the labelled one
+   @return void
+ */
+void PublishFrame( CameraFrame &frame )
+{
+	CentroidPub(frame.centroid, frame.centroidRadius, frame.detection, frame.stamp);
+	stampToCentroid.add(frame.stamp, ros::Time::now());
+
+	if(headless && ballCentroidImage_pub.getNumSubscribers() == 0)
+		return;
+
+	// the captured image may be shared with the received message, so it is drawn on a copy
+	Mat dst;
+	if(frame.bayer >= 0)
+		cvtColor(frame.image, dst, frame.bayer);
+	else
+		dst = frame.image.clone();
+	if(!frame.contour.empty())
+	{
+		std::stringstream s;
+		s<<frame.centroidRadius.z;
+		setLabel(dst, s.str(), frame.contour);
+	}
+	frame.image = dst;
+}
 
-				camera_vector = CameraMatrix1.inv() * (Dist * image_vector);
-				//cout << camera_vector << endl; // DEBUGGING
-				//cout << CameraMatrix1.inv() << endl; // DEBUGGING
-				centroidRadius.x = camera_vector.at<double>(0);
-				centroidRadius.y = camera_vector.at<double>(1);
-				centroidRadius.z = camera_vector.at<double>(2);
-				//cout << centroidRadius << endl; // DEBUGGING
-			}
-		}
+/**
+   @brief Runs a stage of the detection pipeline on the frames of its input queue until the queue is closed
+   @param[in] process stage
+   @param[in] in queue of the stage
+   @param[in] out queue of the next stage, NULL for the last stage
+   @param[in] latency histogram of the time from the end of the previous stage to the end of this one, waiting included
+   @return void
+ */
+void PipelineStage( void (*process)(CameraFrame&), BoundedQueue<CameraFramePtr> *in, BoundedQueue<CameraFramePtr> *out,
+                    LatencyHistogram *latency )
+{
+	CameraFramePtr frame;
+	while(in->pop(frame))
+	{
+		process(*frame);
+		ros::Time done = ros::Time::now();
+		latency->add(frame->mark, done);
+		frame->mark = done;
+		if(out)
+			out->push(frame);
 	}
-	CentroidPub(centroid, centroidRadius);
-	imshow("Circle", dst);
+	if(out)
+		out->close();
 }
 
 /**
    @brief Publishes the detected ball center
    @param[in] centroid detected ball center in pixels
    @param[in] centroidRadius detected ball center in the camera frame
+   @param[in] detection detected ball center in the camera frame, with its uncertainty
+   @param[in] stamp acquisition time of the image
    @return void
  */
-void CentroidPub( const pcl::PointXYZ centroid, const pcl::PointXYZ centroidRadius )
+void CentroidPub( const pcl::PointXYZ centroid, const pcl::PointXYZ centroidRadius, calibration_gui::SphereDetection &detection, const ros::Time &stamp )
 {
 	// Method based on solvePnP ================================================
 	geometry_msgs::PointStamped CentroidCam;
@@ -307,7 +547,7 @@ void CentroidPub( const pcl::PointXYZ centroid, const pcl::PointXYZ centroidRadi
 	CentroidCam.point.y = centroid.y;
 	CentroidCam.point.z = centroid.z;
 
-	CentroidCam.header.stamp = ros::Time::now();
+	CentroidCam.header.stamp = stamp;
 	ballCentroidCamPnP_pub.publish(CentroidCam);
 	//std::cout << CentroidCam << std::endl;
 
@@ -316,9 +556,11 @@ void CentroidPub( const pcl::PointXYZ centroid, const pcl::PointXYZ centroidRadi
 	CentroidCam.point.y = centroidRadius.y;
 	CentroidCam.point.z = centroidRadius.z;
 
-	CentroidCam.header.stamp = ros::Time::now();
 	ballCentroidCam_pub.publish(CentroidCam);
 	//std::cout << CentroidCam << std::endl;
+
+	detection.header.stamp = CentroidCam.header.stamp;
+	ballDetectionCam_pub.publish(detection);
 }
 
 /**
@@ -371,22 +613,53 @@ int main(int argc, char **argv)
 	cout << "Node namespace:" << node_ns << endl;
 	cout << "Ball diameter:" << BALL_DIAMETER << endl;
 
-	//read calibration paraneters
-	string a="/intrinsic_calibrations/ros_calib.yaml";
-	string path = ros::package::getPath("calibration_gui");
-	path += a;
-	FileStorage fs(path, FileStorage::READ);
-	if(!fs.isOpened())
+	// intrinsics of this camera, from its entry in the cameras map of the calibration file. CM1 and D1 are only used
+	// without one when this is the single camera of the session
+	bool singleCamera = true;
+	n.getParam("singleCamera", singleCamera);
+	string path = ros::package::getPath("calibration_gui") + "/intrinsic_calibrations/ros_calib.yaml";
+	CameraIntrinsics intrinsics;
+	if(!intrinsics.load(path) || !intrinsics.get(node_ns, singleCamera, CameraMatrix1, disCoeffs1))
 	{
-		cout<<"failed to open document"<<endl;
+		cout<<"failed to read the intrinsics of "<<node_ns<<" from "<<path
+		    <<(singleCamera ? "" : ", each camera of a multi-camera session needs its own entry")<<endl;
 		return -1;
 	}
-
-	fs["CM1"] >> CameraMatrix1;
-	fs["D1"] >> disCoeffs1;
+	if(!intrinsics.contains(node_ns))
+		cout<<"no intrinsics for "<<node_ns<<", using CM1 and D1"<<endl;
+	// the intrinsics were calibrated on the whole sensor with calibrationBinning binning (Format7 mode 1), they are moved
+	// to the binning and offset the driver applied
+	int calibrationBinning = 2;
+	n.getParam("calibrationBinning", calibrationBinning);
+	sensor_msgs::CameraInfoConstPtr window = ros::topic::waitForMessage<sensor_msgs::CameraInfo>("/" + node_ns + "/camera_info");
+	if(!window)
+		return -1;
+	CameraMatrix1 = cameraMatrixForWindow(CameraMatrix1, calibrationBinning, std::max(window->binning_x, 1u),
+	                                      std::max(window->binning_y, 1u), window->roi.x_offset, window->roi.y_offset);
+	cout<<"image window: "<<window->roi.width<<"x"<<window->roi.height<<" at ("<<window->roi.x_offset<<", "
+	    <<window->roi.y_offset<<"), "<<window->binning_x<<"x"<<window->binning_y<<" binning"<<endl;
 	std::cout << CameraMatrix1 << std::endl;
 	std::cout << disCoeffs1 << std::endl;
 
+	// false to undistort every frame (remap with precomputed tables) instead of the ball contour only
+	n.getParam("undistortContour", undistortContour);
+	// false to segment with cvtColor, inRange, dilate and erode
+	n.getParam("fusedSegmentation", fusedSegmentation);
+	// window around the last detection (negative margin to disable), with a full frame search every fullSearchInterval frames
+	int fullSearchInterval = 30;
+	n.getParam("roiMargin", roiMargin);
+	n.getParam("fullSearchInterval", fullSearchInterval);
+	roi = ImageROI(roiMargin, fullSearchInterval);
+	// without a display the HSV range is read from the lowH, highH, lowS, highS, lowV and highV parameters at run time
+	n.getParam("headless", headless);
+	// frames waiting between two stages of the pipeline, older frames are dropped
+	int queueSize = 2;
+	n.getParam("queueSize", queueSize);
+	UpdateTunables(n, true);
+	// true to subscribe to the mosaic (image_raw) instead of the BGR images (RawImage). Bayer images are segmented at
+	// half resolution and demosaiced only around the ball (needs undistortContour)
+	bool bayerSegmentation = false;
+	n.getParam("bayerSegmentation", bayerSegmentation);
 
 	image_transport::ImageTransport it(n);
 
@@ -397,28 +670,70 @@ int main(int argc, char **argv)
 	ballCentroidImage_pub = it.advertise(ballDetection_topic + "/BallDetection", 1);
 	ballCentroidCam_pub = n.advertise<geometry_msgs::PointStamped>( ballDetection_topic + "/SphereCentroid", 1);
 	ballCentroidCamPnP_pub = n.advertise<geometry_msgs::PointStamped>( ballDetection_topic + "/SphereCentroidPnP", 1);
-
-	CameraRaw cameraRaw(node_ns);
-
-	CreateTrackbarsAndWindows ();
-
-	ros::Rate loop_rate(15);
-
-	std::cout << "test" << std::endl;
+	ballDetectionCam_pub = n.advertise<calibration_gui::SphereDetection>( ballDetection_topic + "/SphereDetection", 1);
+
+	// capture and conversion in the subscriber callback, then segmentation, detection and publishing each in a thread
+	BoundedQueue<CameraFramePtr> frames(queueSize), segmented(queueSize), detected(queueSize), display(1);
+	CameraRaw cameraRaw(node_ns, frames, bayerSegmentation && undistortContour, stampToReceive);
+
+	boost::thread_group pipeline;
+	pipeline.create_thread(boost::bind(PipelineStage, ImageProcessing, &frames, &segmented, &receiveToSegmented));
+	pipeline.create_thread(boost::bind(PipelineStage, PolygonalCurveDetection, &segmented, &detected, &segmentedToDetected));
+	pipeline.create_thread(boost::bind(PipelineStage, PublishFrame, &detected, headless ? (BoundedQueue<CameraFramePtr>*)NULL : &display,
+	                                   &detectedToPublished));
+
+	// latency of the stages, reported every latencyPeriod seconds
+	double latencyPeriod = 5;
+	n.getParam("latencyPeriod", latencyPeriod);
+	ros::Publisher latency_pub = n.advertise<diagnostic_msgs::DiagnosticArray>(raw_data_topic + "/latency", 1);
+	std::vector<LatencyHistogram*> latencies;
+	latencies.push_back(&stampToReceive);
+	latencies.push_back(&receiveToSegmented);
+	latencies.push_back(&segmentedToDetected);
+	latencies.push_back(&detectedToPublished);
+	latencies.push_back(&stampToCentroid);
+	ros::Time lastReport = ros::Time::now();
+
+	if(!headless)
+		CreateTrackbarsAndWindows ();
+
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	// the windows and trackbars are only handled in this thread
+	ros::Rate loop_rate(30);
 	while (ros::ok())
 	{
-		std::cout << "test2" << std::endl;
+		UpdateTunables(n, headless);
 
-		if(!cameraRaw.camImage.empty()) {
-		 	ImageProcessing(cameraRaw.camImage);
+		if((ros::Time::now() - lastReport).toSec() >= latencyPeriod)
+		{
+			latency_pub.publish(LatencyReport(latencies, node_ns));
+			lastReport = ros::Time::now();
 		}
 
+		CameraFramePtr frame;
+		if(!headless && display.tryPop(frame))
+		{
+			if(!frame->imgBinary.empty())
+				imshow("Binary Image", frame->imgBinary);
+			imshow("Circle", frame->image);
+		}
+		if(!headless)
+			waitKey(1);
 
-std::cout << "test3" << std::endl;
-		ros::spinOnce();
 		loop_rate.sleep();
 	}
 
+	spinner.stop();
+	frames.close();
+	pipeline.join_all();
+	ROS_INFO("Frames dropped: %u before segmentation, %u before detection, %u before publishing",
+	         frames.dropped(), segmented.dropped(), detected.dropped());
+
+	if(headless)
+		return 0;
+
 	//destroy the windows
 	destroyWindow("Camera");
 	destroyWindow("Binary Image");
@@ -36,6 +36,9 @@
 #include <lidar_segmentation/lidar_segmentation.h>
 #include "calibration_gui/sick_ldmrs.h"
 #include "calibration_gui/common_functions.h"
+#include "calibration_gui/laser_conversion.h"
+#include "calibration_gui/sphere_fitting.h"
+#include "calibration_gui/sphere_detection.h"
 #include <lidar_segmentation/clustering.h>
 #include <lidar_segmentation/groundtruth.h>
 #include "calibration_gui/visualization_rviz_ldmrs.h"
@@ -62,6 +65,7 @@
 //Marker's publisher
 ros::Publisher markers_ldmrs_pub;
 ros::Publisher sphereCentroid_pub;
+ros::Publisher sphereDetection_pub;
 
 geometry_msgs::PointStamped sphereCentroid;
 vector <int> scan_ldmrs_header;
@@ -77,8 +81,11 @@ void dataFromFileHandler(vector<MultiScanPtr>& lidarPoints, vector<int> iteratio
 	vector<LidarClustersPtr> clusters;
 	vector<LidarClustersPtr> circlePoints;
 	vector<double> radius;
+	vector<CircleFit> fits;
 	vector<geometry_msgs::Point> center;
 	Point sphere;
+	calibration_gui::SphereDetection detection;
+	invalidDetection(detection);
 
 	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
 
@@ -121,11 +128,13 @@ void dataFromFileHandler(vector<MultiScanPtr>& lidarPoints, vector<int> iteratio
 		LidarClustersPtr circlePs (new LidarClusters);
 		vector<ClusterPtr> circleP;
 		double r;
-		r=find_circle(clusters_nn,circleP,n);
+		CircleFit fit;
+		r=find_circle(clusters_nn,circleP,n,fit);
 		int num;
 		if(r!=0)
 			num++;
 		radius.push_back(r);
+		fits.push_back(fit);
 		circlePs->Clusters = circleP;
 		circlePoints.push_back(circlePs);
 
@@ -155,7 +164,7 @@ void dataFromFileHandler(vector<MultiScanPtr>& lidarPoints, vector<int> iteratio
 		{
 			if(circlesNumb>1)
 			{
-				calculateSphereCentroid(center, sphereCentroid, radius);
+				calculateSphereCentroid(center, sphereCentroid, radius, fits, detection);
 				sphere.x=sphereCentroid.point.x;
 				sphere.y=sphereCentroid.point.y;
 				sphere.z=sphereCentroid.point.z;
@@ -168,6 +177,8 @@ void dataFromFileHandler(vector<MultiScanPtr>& lidarPoints, vector<int> iteratio
 			}
 			sphereCentroid.header.stamp = ros::Time::now();
 			sphereCentroid_pub.publish(sphereCentroid);
+			detection.header.stamp = sphereCentroid.header.stamp;
+			sphereDetection_pub.publish(detection);
 		}
 	}
 	vector<ClusterPtr> linePoints;
@@ -187,20 +198,26 @@ void dataFromFileHandler(vector<MultiScanPtr>& lidarPoints, vector<int> iteratio
    @param[in] center coordinates of circle centers from the four layers
    @param[out] sphereCentroid coordinates of the sphere centroid
    @param[in] radius radius of the several circles
+   @param[in] fits circle fits of the four layers
+   @param[out] detection sphere centroid with the number of points, residual and covariance of the estimate
    @return void
  */
-void calculateSphereCentroid(vector<geometry_msgs::Point> center, geometry_msgs::PointStamped & sphereCentroid, vector<double> radius)
+void calculateSphereCentroid(vector<geometry_msgs::Point> center, geometry_msgs::PointStamped & sphereCentroid, vector<double> radius,
+                             const vector<CircleFit>& fits, calibration_gui::SphereDetection& detection)
 {
 	int count=0;
-	double d;
 	sphereCentroid.point.x=0;
 	sphereCentroid.point.y=0;
 	sphereCentroid.point.z=0;
-	int s0, s1, s2, s3;
-	s0=1;
-	s1=1;
-	s2=1;
-	s3=1;
+
+	// the layer estimates are averaged, so their covariances are summed and scaled by 1/count^2.
+	// The layer rotations (at most 1.2 deg) are neglected in the propagation
+	double covariance[3][3]={{0,0,0},{0,0,0},{0,0,0}};
+	double squaredResidual=0;
+	size_t inliers=0;
+
+	// rotation of each layer in relation to the XY plane
+	const double layerAngle[4] = {-1.2, -0.4, 0.4, 1.2};
 
 	// cout << "calculateSphereCentroid Radius = " << endl;
 	// cout << radius[0] << endl;
@@ -210,64 +227,39 @@ void calculateSphereCentroid(vector<geometry_msgs::Point> center, geometry_msgs:
 
 	for(int i=0; i<4; i++)
 	{
+		if(radius[i]<=0)
+			continue;
+
 		double ballDiameter = BALL_DIAMETER;
-		if(i==0 && radius[0]>0)
-		{
-			rotatePoints(center[0].x,center[0].y,center[0].z,-1.2*M_PI/180);
-			d=pow(ballDiameter/2,2)-pow(radius[0],2);
-			if(d<0)
-				d=0;
-			center[0].z=s0* sqrt(d);
-			rotatePoints(center[0].x,center[0].y,center[0].z,1.2*M_PI/180);
-			sphereCentroid.point.x+=(center[0].x);
-			sphereCentroid.point.y+=(center[0].y);
-			sphereCentroid.point.z+=(center[0].z);
-			count++;
-		}
-		if(i==1 && radius[1]>0)
-		{
-			rotatePoints(center[1].x,center[1].y,center[1].z,-0.4*M_PI/180);
-			d=pow(ballDiameter/2,2)-pow(radius[1],2);
-			if(d<0)
-				d=0;
-			center[1].z= s1*sqrt(d);
-			rotatePoints(center[1].x,center[1].y,center[1].z,0.4*M_PI/180);
-			sphereCentroid.point.x+=(center[1].x);
-			sphereCentroid.point.y+=(center[1].y);
-			sphereCentroid.point.z+=(center[1].z);
-			count++;
-		}
-		if(i==2 && radius[2]>0)
-		{
-			rotatePoints(center[2].x,center[2].y,center[2].z,0.4*M_PI/180);
-			d=pow(ballDiameter/2,2)-pow(radius[2],2);
-			if(d<0)
-				d=0;
-			center[2].z= s2*sqrt(d);
-			rotatePoints(center[2].x,center[2].y,center[2].z,-0.4*M_PI/180);
-			sphereCentroid.point.x+=(center[2].x);
-			sphereCentroid.point.y+=(center[2].y);
-			sphereCentroid.point.z+=(center[2].z);
-			count++;
-		}
-		if(i==3 && radius[3]>0)
-		{
-			rotatePoints(center[3].x,center[3].y,center[3].z,1.2*M_PI/180);
-			d=pow(ballDiameter/2,2)-pow(radius[3],2);
-			if(d<0)
-				d=0;
-			center[3].z= s3*sqrt(d);
-			rotatePoints(center[3].x,center[3].y,center[3].z,-1.2*M_PI/180);
-			sphereCentroid.point.x+=(center[3].x);
-			sphereCentroid.point.y+=(center[3].y);
-			sphereCentroid.point.z+=(center[3].z);
-			count++;
-		}
+		rotatePoints(center[i].x,center[i].y,center[i].z,layerAngle[i]*M_PI/180);
+		center[i].z=sphereOffsetFromCircle(radius[i], ballDiameter/2);
+		rotatePoints(center[i].x,center[i].y,center[i].z,-layerAngle[i]*M_PI/180);
+		sphereCentroid.point.x+=(center[i].x);
+		sphereCentroid.point.y+=(center[i].y);
+		sphereCentroid.point.z+=(center[i].z);
+		count++;
+
+		double layerCovariance[3][3];
+		sphereCovarianceFromCircle(fits[i], ballDiameter/2, layerCovariance);
+		for(int r=0; r<3; r++)
+			for(int c=0; c<3; c++)
+				covariance[r][c]+=layerCovariance[r][c];
+		squaredResidual+=fits[i].points*fits[i].residual*fits[i].residual;
+		inliers+=fits[i].points;
 	}
 
 	sphereCentroid.point.x=sphereCentroid.point.x/count;
 	sphereCentroid.point.y=sphereCentroid.point.y/count;
 	sphereCentroid.point.z=sphereCentroid.point.z/count;
+
+	for(int r=0; r<3; r++)
+		for(int c=0; c<3; c++)
+			covariance[r][c]/=count*count;
+	detection.valid=true;
+	detection.point=sphereCentroid.point;
+	detection.inliers=inliers;
+	detection.residual=inliers>0 ? sqrt(squaredResidual/inliers) : 0;
+	setDetectionCovariance(detection, covariance);
 	double centre[3];
 	centre[0]=sphereCentroid.point.x;
 	centre[1]=sphereCentroid.point.y;
@@ -281,9 +273,10 @@ void calculateSphereCentroid(vector<geometry_msgs::Point> center, geometry_msgs:
    @param[in] clusters segmented scan from the laser
    @param[out] circleP point coordinates of the circle detected for representation on rviz
    @param[in] layer number of the scan
+   @param[out] fit circle fit of the detected circle, in the plane of the layer
    @return double radius of the detected circle
  */
-double find_circle(vector<ClusterPtr> clusters, vector<ClusterPtr>& circleP, int layer)
+double find_circle(vector<ClusterPtr> clusters, vector<ClusterPtr>& circleP, int layer, CircleFit& fit)
 {
 	int count=0;
 	double radius=0;
@@ -292,137 +285,101 @@ double find_circle(vector<ClusterPtr> clusters, vector<ClusterPtr>& circleP, int
 	{
 		ClusterPtr cluster=clusters[k];
 		int segment_init, segment_end;
-		for (int i=0; i<cluster->support_points.size(); i++)
-		{
+		segment_init=0;
+		segment_end=cluster->support_points.size()-1;
 
-			segment_init=0;
-			segment_end=cluster->support_points.size()-1;
+		// Detect if at least 6 points
+		if (segment_end-segment_init>=5)
+		{
+			// average inscribed angle and std, already in degrees
+			double m, std;
+			inscribedAngleStatistics(cluster, m, std);
 
-			// Detect if at least 6 points
-			double angle[1000];
-			double angle_std;
-			double vecA[3],vecB[3];
-			int n=0;
-			if (segment_end-segment_init>=5)
+			//if (m>90 && m<135 && std < 8.6)
+			//if (m>90 && m<145 && std < 12) // ATLASCAR
+			if (m>90 && m<145 && std < 8.5)
 			{
-				for (int j=segment_init+1; j<segment_end-1; j++)
-				{
-					// use 3D but actually Z = 0 because laserscan is planar
-					vecA[0] = cluster->support_points[segment_init]->x - cluster->support_points[j]->x;
-					vecA[1] = cluster->support_points[segment_init]->y - cluster->support_points[j]->y;
-					vecA[2] = cluster->support_points[segment_init]->z - cluster->support_points[j]->z;
-
-					vecB[0] = cluster->support_points[segment_end]->x - cluster->support_points[j]->x;
-					vecB[1] = cluster->support_points[segment_end]->y - cluster->support_points[j]->y;
-					vecB[2] = cluster->support_points[segment_end]->z - cluster->support_points[j]->z;
-
-					angle[n] = acos( inner_product(vecA, vecA+3, vecB, 0.0)
-					                 / (sqrt(pow(vecA[0],2) + pow(vecA[1],2) + pow(vecA[2],2)) * sqrt(pow(vecB[0],2) + pow(vecB[1],2) + pow(vecB[2],2))));
-					n++;
-				}
-				// compute average angle and std
-				double m=0;
-				double std=0;
-
-				for (int j = 0; j < n; j++)
-					m += angle[j];
-
-				m = m/n;
-				for ( int j = 0; j < n; j++ )
-				{
-					std += pow((angle[j]-m),2);
-				}
-
-				std = sqrt(std/(n-1));
-
-				// conversion to degree
-				m = m/M_PI*180;
-				std = std/M_PI*180;
-
-				//if (m>90 && m<135 && std < 8.6)
-				//if (m>90 && m<145 && std < 12) // ATLASCAR
-				if (m>90 && m<145 && std < 8.5)
-				{
-					// std::cout << "std = " << std << std::endl;
-					// std::cout << "m = " << m << std::endl;
-					double ma,mb,cx,x1,x2,x3,cy,y1,y2,y3,z1,z2,z3;
-					x1=cluster->support_points[segment_init]->x;
-					x2=cluster->support_points[round(segment_end/2)]->x;
-					x3=cluster->support_points[segment_end]->x;
-					y1=cluster->support_points[segment_init]->y;
-					y2=cluster->support_points[round(segment_end/2)]->y;
-					y3=cluster->support_points[segment_end]->y;
-					z1=cluster->support_points[segment_init]->z;
-					z2=cluster->support_points[round(segment_end/2)]->z;
-					z3=cluster->support_points[segment_end]->z;
-
-					//rotate da points to da plane XY
-					double Angle;
-					if(layer==0)
-						Angle=-1.2*M_PI/180;
-					else if(layer==1)
-						Angle=-0.4*M_PI/180;
-					else if(layer==2)
-						Angle=0.4*M_PI/180;
-					else if(layer==3)
-						Angle=1.2*M_PI/180;
-
-					for(int i=0; i<cluster->support_points.size(); i++)
-						rotatePoints(cluster->support_points[i]->x,cluster->support_points[i]->y, cluster->support_points[i]->z, Angle);
-
-					Point centroid;
-					double R;
-					CalculateCircle(cluster,R,centroid);
-
-					double z=0;
-					rotatePoints(centroid.x,centroid.y,z,-Angle);
-
-					for(int i=0; i<cluster->support_points.size(); i++)
-						rotatePoints(cluster->support_points[i]->x,cluster->support_points[i]->y, cluster->support_points[i]->z, -Angle);
-
-
-					rotatePoints(x1,y1, z1, Angle);
-					rotatePoints(x2,y2, z2, Angle);
-					rotatePoints(x3,y3, z3, Angle);
-
-					ma=(y2-y1)/(x2-x1);
-					mb=(y3-y2)/(x3-x2);
-
-					cx=(ma*mb*(y1-y3)+mb*(x1+x2)-ma*(x2+x3))/(2*(mb-ma));
-					cy=-1/ma*(cx-(x1+x2)/2)+(y1+y2)/2;
-
-					radius=sqrt(pow((cx-x1),2) + pow((cy-y1),2));
-					radius=R;
-
-					rotatePoints(cx,cy,z1,-Angle);
-					double circle[3];
-					circle[0]=centroid.x;
-					circle[1]=centroid.y;
-					circle[2]=z;
-
-					double centre[3];
-					centre[0] = circle[0];
-					centre[1] = circle[1];
-					centre[2] = circle[2];
-
-					sphereCentroid.point.x=circle[0];
-					sphereCentroid.point.y=circle[1];
-					sphereCentroid.point.z=circle[2];
-
-					circlePoints(circleP,radius,centre,20);
-					if(!circleP.empty())
-						circleP[count]->centroid=cluster->centroid;
-					count++;
-					checkCircle=true;
-				}
-				else
+				// std::cout << "std = " << std << std::endl;
+				// std::cout << "m = " << m << std::endl;
+				double ma,mb,cx,x1,x2,x3,cy,y1,y2,y3,z1,z2,z3;
+				x1=cluster->support_points[segment_init]->x;
+				x2=cluster->support_points[round(segment_end/2)]->x;
+				x3=cluster->support_points[segment_end]->x;
+				y1=cluster->support_points[segment_init]->y;
+				y2=cluster->support_points[round(segment_end/2)]->y;
+				y3=cluster->support_points[segment_end]->y;
+				z1=cluster->support_points[segment_init]->z;
+				z2=cluster->support_points[round(segment_end/2)]->z;
+				z3=cluster->support_points[segment_end]->z;
+
+				//rotate da points to da plane XY
+				double Angle;
+				if(layer==0)
+					Angle=-1.2*M_PI/180;
+				else if(layer==1)
+					Angle=-0.4*M_PI/180;
+				else if(layer==2)
+					Angle=0.4*M_PI/180;
+				else if(layer==3)
+					Angle=1.2*M_PI/180;
+
+				for(int i=0; i<cluster->support_points.size(); i++)
+					rotatePoints(cluster->support_points[i]->x,cluster->support_points[i]->y, cluster->support_points[i]->z, Angle);
+
+				CalculateCircle(cluster,fit);
+				Point centroid;
+				centroid.x=fit.x;
+				centroid.y=fit.y;
+				double R=fit.radius;
+
+				double z=0;
+				rotatePoints(centroid.x,centroid.y,z,-Angle);
+
+				for(int i=0; i<cluster->support_points.size(); i++)
+					rotatePoints(cluster->support_points[i]->x,cluster->support_points[i]->y, cluster->support_points[i]->z, -Angle);
+
+
+				rotatePoints(x1,y1, z1, Angle);
+				rotatePoints(x2,y2, z2, Angle);
+				rotatePoints(x3,y3, z3, Angle);
+
+				ma=(y2-y1)/(x2-x1);
+				mb=(y3-y2)/(x3-x2);
+
+				cx=(ma*mb*(y1-y3)+mb*(x1+x2)-ma*(x2+x3))/(2*(mb-ma));
+				cy=-1/ma*(cx-(x1+x2)/2)+(y1+y2)/2;
+
+				radius=sqrt(pow((cx-x1),2) + pow((cy-y1),2));
+				radius=R;
+
+				rotatePoints(cx,cy,z1,-Angle);
+				double circle[3];
+				circle[0]=centroid.x;
+				circle[1]=centroid.y;
+				circle[2]=z;
+
+				double centre[3];
+				centre[0] = circle[0];
+				centre[1] = circle[1];
+				centre[2] = circle[2];
+
+				sphereCentroid.point.x=circle[0];
+				sphereCentroid.point.y=circle[1];
+				sphereCentroid.point.z=circle[2];
+
+				circlePoints(circleP,radius,centre,20);
+				if(!circleP.empty())
+					circleP[count]->centroid=cluster->centroid;
+				count++;
+				checkCircle=true;
+			}
+			else
+			{
+				if(checkCircle==false)
 				{
-					if(checkCircle==false)
-					{
-						sphereCentroid.point.x=-999;
-						sphereCentroid.point.y=-999;
-						sphereCentroid.point.z=-999;
-					}
+					sphereCentroid.point.x=-999;
+					sphereCentroid.point.y=-999;
+					sphereCentroid.point.z=-999;
 				}
 			}
 		}
@@ -448,40 +405,6 @@ void rotatePoints(double& x,double& y, double& z, double angle)
 	y=Y;
 }
 
-/**
-   @brief Convert data to XYZ
-   @param[in] scan laser scan
-   @param[out] data_gt converted data
-   @param[in] rot rotation of the scan layer in relation to the XY plane
-   @return void
- */
-void convertDataToXYZ(sensor_msgs::LaserScan scan, vector<C_DataFromFilePtr>& data_gt, double rot)
-{
-	C_DataFromFilePtr data (new C_DataFromFile);
-	int s=scan.ranges.size();
-	int l=1;
-	double X, Y;
-	for(int n=0; n<s; n++)
-	{
-		double angle, d, x, y, z;
-		d=scan.ranges[n]*cos(rot*M_PI/180);
-		z=scan.ranges[n]*sin(rot*M_PI/180);
-		angle = scan.angle_min + n*scan.angle_increment;
-
-		x=d*cos(angle);
-		y=d*sin(angle);
-
-		X+=x;
-		Y+=y;
-		data->x_valuesf.push_back(x);
-		data->y_valuesf.push_back(y);
-		data->z_valuesf.push_back(z);
-		data->labels.push_back(l);
-	}
-	data->iteration=s;
-	data_gt.push_back(data);
-}
-
 /**
    @brief Main function of the sick_ldmrs node
    @param argc
@@ -503,58 +426,32 @@ int main(int argc, char **argv)
 
 	markers_ldmrs_pub = n.advertise<visualization_msgs::MarkerArray>( "BallDetection", 10000);
 	sphereCentroid_pub = n.advertise<geometry_msgs::PointStamped>("SphereCentroid",1000);
+	sphereDetection_pub = n.advertise<calibration_gui::SphereDetection>("SphereDetection",1000);
 
 	ros::Rate loop_rate(50);
 
+	// Direction tables of the four layers, rebuilt only if the scan configuration changes
+	LaserDirectionTable layers[4];
+	const double layerRotation[4] = {-1.2, -0.4, 0.4, 1.2};
+
 	while(ros::ok())
 	{
-		vector<C_DataFromFilePtr> data_gt;
 		//cout<<"size "<<scan.scan0.ranges.size()<<endl;
 		vector<MultiScanPtr> lidarPoints;
-		vector<PointPtr> points;
 
 		if(scan.scan3.ranges.size()!=0)
 		{
+			const sensor_msgs::LaserScan* scans[4] = {&scan.scan0, &scan.scan1, &scan.scan2, &scan.scan3};
+			scan_ldmrs_header.clear();
 
-			//first scan
-			MultiScanPtr scanPoints0 (new MultiScan);
-			convertDataToXYZ(scan.scan0, data_gt,-1.2);
-
-			createPointsFromFile(points, data_gt[0] );
-			scanPoints0->Points=points;
-			lidarPoints.push_back(scanPoints0);
-			scan_ldmrs_header.push_back(data_gt[0]->iteration);
-
-			//second scan
-			MultiScanPtr scanPoints1 (new MultiScan);
-			convertDataToXYZ(scan.scan1, data_gt,-0.4);
-			points.clear();
-
-			createPointsFromFile(points, data_gt[1] );
-			scanPoints1->Points=points;
-			lidarPoints.push_back(scanPoints1);
-			scan_ldmrs_header.push_back(data_gt[1]->iteration);
-
-			//third scan
-			MultiScanPtr scanPoints2 (new MultiScan);
-			convertDataToXYZ(scan.scan2, data_gt,0.4);
-			points.clear();
-
-			createPointsFromFile(points, data_gt[2] );
-			scanPoints2->Points=points;
-			lidarPoints.push_back(scanPoints2);
-			scan_ldmrs_header.push_back(data_gt[2]->iteration);
-
-			//fourth scan
-			MultiScanPtr scanPoints3 (new MultiScan);
-			convertDataToXYZ(scan.scan3, data_gt,1.2);
-			points.clear();
-
-			createPointsFromFile(points, data_gt[3] );
-			scanPoints3->Points=points;
-			lidarPoints.push_back(scanPoints3);
-			scan_ldmrs_header.push_back(data_gt[3]->iteration);
-
+			for(int l=0; l<4; l++)
+			{
+				MultiScanPtr scanPoints (new MultiScan);
+				layers[l].configure(*scans[l], layerRotation[l]);
+				layers[l].convert(*scans[l], scanPoints->Points);
+				lidarPoints.push_back(scanPoints);
+				scan_ldmrs_header.push_back(scans[l]->ranges.size());
+			}
 
 			dataFromFileHandler(lidarPoints, scan_ldmrs_header);
 		}
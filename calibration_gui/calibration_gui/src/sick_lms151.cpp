@@ -36,6 +36,9 @@
 #include <lidar_segmentation/groundtruth.h>
 #include "calibration_gui/common_functions.h"
 #include "calibration_gui/sick_lms151_1.h"
+#include "calibration_gui/laser_conversion.h"
+#include "calibration_gui/sphere_fitting.h"
+#include "calibration_gui/sphere_detection.h"
 #include "calibration_gui/visualization_rviz_lms.h"
 #include <cmath>
 #include <algorithm>
@@ -51,9 +54,13 @@
 //Marker's publisher
 ros::Publisher markers_lms_pub;
 ros::Publisher circleCentroid_pub;
+ros::Publisher sphereDetection_pub;
 int scan_lms_header;
 int checkCircle=0;
 
+// Rolling window of scans merged while the ball is stationary, disabled with a window of 1
+ScanAccumulator accumulator;
+
 /**
    @brief Handler for the incoming data
    @param[in] groundtruth_points incoming Laser Points
@@ -124,162 +131,152 @@ double find_circle(vector<ClusterPtr> clusters, vector<ClusterPtr>& circleP, Poi
 	centroid.point.x=-999;
 	centroid.point.y=-999;
 	centroid.point.z=-999;
+	calibration_gui::SphereDetection detection;
+	invalidDetection(detection);
 	int count=0;
+	double radius=0;
 	for(int k=0; k<clusters.size(); k++)
 	{
 		ClusterPtr cluster=clusters[k];
 		int segment_init, segment_end;
-		for (int i=0; i<cluster->support_points.size(); i++)
-		{
-			// Apply algorithm from
-			/*Fast Line, Arc/Circle and Leg Detection from
-			   Laser Scan Data in a Player Driver
-			   João Xavier∗ , Marco Pacheco† , Daniel Castro† , António Ruano† and Urbano Nunes*/
-
-			segment_init=0;
-			segment_end=cluster->support_points.size()-1;
-
-			// Detect if at least 6 points
-			double angle[1000];
-			double angle_std;
-			double vecA[3],vecB[3];
-			int n=0;
-			if (segment_end-segment_init>=6)
-			{
-				for (int j=segment_init+1; j<segment_end-1; j++)
-				{
-					// use 3D but actually Z = 0 because laserscan is planar
-					vecA[0] = cluster->support_points[segment_init]->x - cluster->support_points[j]->x;
-					vecA[1] = cluster->support_points[segment_init]->y - cluster->support_points[j]->y;
-					vecA[2] = cluster->support_points[segment_init]->z - cluster->support_points[j]->z;
-
-					vecB[0] = cluster->support_points[segment_end]->x - cluster->support_points[j]->x;
-					vecB[1] = cluster->support_points[segment_end]->y - cluster->support_points[j]->y;
-					vecB[2] = cluster->support_points[segment_end]->z - cluster->support_points[j]->z;
-
-					angle[n] = acos( inner_product(vecA, vecA+3, vecB, 0.0)
-					                 / (sqrt(pow(vecA[0],2) + pow(vecA[1],2) + pow(vecA[2],2)) * sqrt(pow(vecB[0],2) + pow(vecB[1],2) + pow(vecB[2],2))));
-					n++;
-				}
 
+		// Apply algorithm from
+		/*Fast Line, Arc/Circle and Leg Detection from
+		   Laser Scan Data in a Player Driver
+		   João Xavier∗ , Marco Pacheco† , Daniel Castro† , António Ruano† and Urbano Nunes*/
 
-				// compute average angle and std
-				double m=0;
-				double std=0;
+		segment_init=0;
+		segment_end=cluster->support_points.size()-1;
 
-				for (int j = 0; j < n; j++)
-					m += angle[j];
-
-				m = m/n;
-				for ( int j = 0; j < n; j++ )
-				{
-					std += pow((angle[j]-m),2);
-				}
-
-				std = sqrt(std/(n-1));
+		// Detect if at least 7 points (span of 6), or 5 (span of 4) if the whole cluster was merged over the full window,
+		// since the averaged ranges are precise enough for the arc test with fewer beams
+		int minimum_span=6;
+		if(accumulator.window()>1)
+		{
+			bool merged=true;
+			for(int i=0; i<cluster->support_points.size() && merged; i++)
+				merged=accumulator.samples(cluster->support_points[i]->label)==accumulator.window();
+			if(merged)
+				minimum_span=4;
+		}
 
-				// conversion to degree
-				m = m/M_PI*180;
-				std = std/M_PI*180;
+		if (segment_end-segment_init>=minimum_span)
+		{
+			// average inscribed angle and std, already in degrees
+			double m, std;
+			inscribedAngleStatistics(cluster, m, std);
 
-				//std::cout << "std = " << std << std::endl;
-				//std::cout << "m = " << m << std::endl;
+			//std::cout << "std = " << std << std::endl;
+			//std::cout << "m = " << m << std::endl;
 
-				//if (m>90 && m<140 && std < 7.5)
-				if (m>105 && m<140 && std < 5)
+			//if (m>90 && m<140 && std < 7.5)
+			if (m>105 && m<140 && std < 5)
+			{
+				// Circle information computation
+				double theta = (m-90)/180*M_PI;
+				// use 3D but actually Z = 0 because laserscan is planar
+				double middle[3];
+				middle[0] = (cluster->support_points[segment_end]->x - cluster->support_points[segment_init]->x)/2;
+				middle[1] = (cluster->support_points[segment_end]->y - cluster->support_points[segment_init]->y)/2;
+				middle[2] = (cluster->support_points[segment_end]->z - cluster->support_points[segment_init]->z)/2;
+
+				double h = sqrt(pow(middle[0],2) + pow(middle[1],2) + pow(middle[2],2)) * tan(theta);
+				double height[3];
+				height[1]= sqrt( (middle[0]*middle[0]*h*h) / (middle[0]*middle[0] + middle[1]*middle[1]) );
+				height[0]= -middle[1]*height[1]/middle[0];
+				height[2]= 0;
+
+				double circle[3];
+				circle[0] = cluster->support_points[segment_init]->x + middle[0] - height[0];
+				circle[1] = cluster->support_points[segment_init]->y + middle[1] - height[1];
+				circle[2] = cluster->support_points[segment_init]->z + middle[2] - height[2];
+				//radius = sqrt(pow((circle[0]-cluster->support_points[segment_init]->x),2) + pow((circle[1]-cluster->support_points[segment_init]->y),2) + pow((circle[2]-cluster->support_points[segment_init]->z),2));
+
+				double ma,mb,cx,x1,x2,x3,cy,y1,y2,y3;
+				x1=cluster->support_points[segment_init]->x;
+				x2=cluster->support_points[round(segment_end/2)]->x;
+				x3=cluster->support_points[segment_end]->x;
+				y1=cluster->support_points[segment_init]->y;
+				y2=cluster->support_points[round(segment_end/2)]->y;
+				y3=cluster->support_points[segment_end]->y;
+
+				ma=(y2-y1)/(x2-x1);
+				mb=(y3-y2)/(x3-x2);
+
+				cx=(ma*mb*(y1-y3)+mb*(x1+x2)-ma*(x2+x3))/(2*(mb-ma));
+				cy=-1/ma*(cx-(x1+x2)/2)+(y1+y2)/2;
+
+				//radius=sqrt(pow((cx-x1),2) + pow((cy-y1),2));
+
+				CircleFit fit;
+				CalculateCircle(cluster,fit);
+				Point Centroid;
+				Centroid.x=fit.x;
+				Centroid.y=fit.y;
+				radius=fit.radius;
+				cout << "Radius = " << radius << endl; // DEBUGGING
+
+				double ballDiameter = BALL_DIAMETER;
+
+				// Determines if the radius is valid or not
+				if(radius > ballDiameter/2  || radius <= 0) // invalid
+				{
+					sphere.x=-10000;
+					sphere.y=centroid.point.y;
+					sphere.z=centroid.point.z;
+					double centre[3];
+					centre[0] = Centroid.x;
+					centre[1] = Centroid.y;
+					centre[2] = 0;
+					circlePoints(circleP,radius,centre,20);
+				}
+				else // valid radius
 				{
-					// Circle information computation
-					double theta = (m-90)/180*M_PI;
-					// use 3D but actually Z = 0 because laserscan is planar
-					double middle[3];
-					middle[0] = (cluster->support_points[segment_end]->x - cluster->support_points[segment_init]->x)/2;
-					middle[1] = (cluster->support_points[segment_end]->y - cluster->support_points[segment_init]->y)/2;
-					middle[2] = (cluster->support_points[segment_end]->z - cluster->support_points[segment_init]->z)/2;
-
-					double h = sqrt(pow(middle[0],2) + pow(middle[1],2) + pow(middle[2],2)) * tan(theta);
-					double height[3];
-					height[1]= sqrt( (middle[0]*middle[0]*h*h) / (middle[0]*middle[0] + middle[1]*middle[1]) );
-					height[0]= -middle[1]*height[1]/middle[0];
-					height[2]= 0;
-
-					double circle[3], radius;
-					circle[0] = cluster->support_points[segment_init]->x + middle[0] - height[0];
-					circle[1] = cluster->support_points[segment_init]->y + middle[1] - height[1];
-					circle[2] = cluster->support_points[segment_init]->z + middle[2] - height[2];
-					//radius = sqrt(pow((circle[0]-cluster->support_points[segment_init]->x),2) + pow((circle[1]-cluster->support_points[segment_init]->y),2) + pow((circle[2]-cluster->support_points[segment_init]->z),2));
-
-					double ma,mb,cx,x1,x2,x3,cy,y1,y2,y3;
-					x1=cluster->support_points[segment_init]->x;
-					x2=cluster->support_points[round(segment_end/2)]->x;
-					x3=cluster->support_points[segment_end]->x;
-					y1=cluster->support_points[segment_init]->y;
-					y2=cluster->support_points[round(segment_end/2)]->y;
-					y3=cluster->support_points[segment_end]->y;
-
-					ma=(y2-y1)/(x2-x1);
-					mb=(y3-y2)/(x3-x2);
-
-					cx=(ma*mb*(y1-y3)+mb*(x1+x2)-ma*(x2+x3))/(2*(mb-ma));
-					cy=-1/ma*(cx-(x1+x2)/2)+(y1+y2)/2;
-
-					//radius=sqrt(pow((cx-x1),2) + pow((cy-y1),2));
-
-					Point Centroid;
-					double R;
-					CalculateCircle(cluster,R,Centroid);
-					radius=R;
-					cout << "Radius = " << radius << endl; // DEBUGGING
-
-					double ballDiameter = BALL_DIAMETER;
-
-					// Determines if the radius is valid or not
-					if(radius > ballDiameter/2  || radius <= 0) // invalid
-					{
-						sphere.x=-10000;
-						sphere.y=centroid.point.y;
-						sphere.z=centroid.point.z;
-						double centre[3];
-						centre[0] = Centroid.x;
-						centre[1] = Centroid.y;
-						centre[2] = 0;
-						circlePoints(circleP,radius,centre,20);
-					}
-					else // valid radius
-					{
-						// std::cout << "valid" << ballDiameter/2 << std::endl;
-						centroid.point.x=Centroid.x;
-						centroid.point.y=Centroid.y;
-						centroid.point.z=(sqrt(pow(ballDiameter/2,2)-pow(radius,2)));
-						sphere.x=centroid.point.x;
-						sphere.y=centroid.point.y;
-						sphere.z=centroid.point.z;
-						//cout<<"x "<<centroid.point.x<<endl;
-						double centre[3];
-						centre[0] = Centroid.x;
-						centre[1] = Centroid.y;
-						centre[2] = centroid.point.z;
-						circlePoints(circleP,radius,centre,20);
-					}
-
-					if(!circleP.empty())
-						circleP[count]->centroid=cluster->centroid;
-					count++;
-					checkCircle=1;
+					// std::cout << "valid" << ballDiameter/2 << std::endl;
+					centroid.point.x=Centroid.x;
+					centroid.point.y=Centroid.y;
+					centroid.point.z=sphereOffsetFromCircle(radius, ballDiameter/2);
+					sphere.x=centroid.point.x;
+					sphere.y=centroid.point.y;
+					sphere.z=centroid.point.z;
+					//cout<<"x "<<centroid.point.x<<endl;
+
+					double covariance[3][3];
+					sphereCovarianceFromCircle(fit, ballDiameter/2, covariance);
+					detection.valid=true;
+					detection.point=centroid.point;
+					detection.inliers=fit.points;
+					detection.residual=fit.residual;
+					setDetectionCovariance(detection, covariance);
+
+					double centre[3];
+					centre[0] = Centroid.x;
+					centre[1] = Centroid.y;
+					centre[2] = centroid.point.z;
+					circlePoints(circleP,radius,centre,20);
 				}
-				else
+
+				if(!circleP.empty())
+					circleP[count]->centroid=cluster->centroid;
+				count++;
+				checkCircle=1;
+			}
+			else
+			{
+				if(checkCircle==0)
 				{
-					if(checkCircle==0)
-					{
-						sphere.x=-10000;
-						sphere.y=centroid.point.y;
-						sphere.z=centroid.point.z;
-					}
+					sphere.x=-10000;
+					sphere.y=centroid.point.y;
+					sphere.z=centroid.point.z;
 				}
 			}
 		}
 	}
 	centroid.header.stamp=ros::Time::now();
 	circleCentroid_pub.publish(centroid);
+	detection.header.stamp=centroid.header.stamp;
+	sphereDetection_pub.publish(detection);
+	return radius;
 }
 
 /**
@@ -297,27 +294,40 @@ int main(int argc, char **argv)
 	string node_ns = ros::this_node::getNamespace();
 	node_ns.erase(0, 2);
 	n.getParam("ballDiameter", BALL_DIAMETER);
+	int accumulateScans=1;
+	double accumulationTolerance=0.03;
+	n.getParam("accumulateScans", accumulateScans);
+	n.getParam("accumulationTolerance", accumulationTolerance);
+	accumulator=ScanAccumulator(accumulateScans, accumulationTolerance);
 	cout << "Node namespace:" << node_ns << endl;
 	cout << "Ball diameter:" << BALL_DIAMETER << endl;
+	cout << "Scans accumulated:" << accumulator.window() << endl;
 
 	sickLMSscan scan(node_ns);
 
 	markers_lms_pub = n.advertise<visualization_msgs::MarkerArray>( "BallDetection", 10000);
 	circleCentroid_pub = n.advertise<geometry_msgs::PointStamped>( "SphereCentroid", 10000);
+	sphereDetection_pub = n.advertise<calibration_gui::SphereDetection>( "SphereDetection", 10000);
 
 	ros::Rate loop_rate(50);
 
+	// Direction table of the scan, rebuilt only if the scan configuration changes
+	LaserDirectionTable directions;
+	// The subscriber only keeps the last scan, so the loop may see a scan again before the next one arrives
+	std_msgs::Header lastScan;
+
 	while(ros::ok())
 	{
-		C_DataFromFilePtr data_gt;
 		//cout<<"size "<<scan.scanLaser.ranges.size()<<endl;
 		vector<PointPtr> points;
-		if(scan.scanLaser.ranges.size()!=0)
+		const std_msgs::Header& header=scan.scanLaser.header;
+		if(scan.scanLaser.ranges.size()!=0 && (header.seq!=lastScan.seq || header.stamp!=lastScan.stamp))
 		{
-			convertDataToXY(scan.scanLaser, data_gt);
-
-			createPointsFromFile(points, data_gt);
-			scan_lms_header=data_gt->iteration;
+			lastScan=header;
+			const sensor_msgs::LaserScan& merged=accumulator.add(scan.scanLaser);
+			directions.configure(merged);
+			directions.convert(merged, points);
+			scan_lms_header=scan.scanLaser.ranges.size();
 
 			dataFromFileHandler(points, scan_lms_header);
 		}
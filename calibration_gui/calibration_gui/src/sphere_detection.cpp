@@ -0,0 +1,114 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  sphere_detection.cpp
+ \brief Helpers to fill the SphereDetection message published by the ball detectors
+ \date   October, 2026
+*/
+
+#include "calibration_gui/sphere_detection.h"
+#include "calibration_gui/sphere_fitting.h"
+
+/**
+@brief Resets a detection to the "ball not found" state.
+The point keeps the -999 marker of the SphereCentroid topic, so both topics agree
+@param[out] detection detection message
+@return void
+*/
+void invalidDetection(calibration_gui::SphereDetection& detection)
+{
+    detection.valid=false;
+    detection.point.x=-999;
+    detection.point.y=-999;
+    detection.point.z=-999;
+    detection.inliers=0;
+    detection.residual=0;
+    for(int i=0; i<9; i++)
+        detection.covariance[i]=0;
+}
+
+/**
+@brief Copies a 3x3 covariance to the row-major field of the message
+@param[out] detection detection message
+@param[in] cov covariance of the ball center
+@return void
+*/
+void setDetectionCovariance(calibration_gui::SphereDetection& detection, const double cov[3][3])
+{
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            detection.covariance[3*i+j]=cov[i][j];
+}
+
+/**
+@brief Fills a detection from a sphere segmented in a point cloud (Kinect and SwissRanger).
+The residual and covariance are computed in one pass over the inliers
+@param[in] cloud point cloud the sphere was segmented from
+@param[in] indices indices of the inliers of the sphere
+@param[in] center sphere center
+@param[in] radius sphere radius
+@param[out] detection detection message
+@return void
+*/
+void sphereDetectionFromInliers(const pcl::PointCloud<pcl::PointXYZ>& cloud, const vector<int>& indices,
+                                const double center[3], double radius, calibration_gui::SphereDetection& detection)
+{
+    size_t n=indices.size();
+    vector<double> x(n), y(n), z(n);
+    for(size_t i=0; i<n; i++)
+    {
+        const pcl::PointXYZ& p=cloud.points[indices[i]];
+        x[i]=p.x;
+        y[i]=p.y;
+        z[i]=p.z;
+    }
+
+    double residual=0, cov[3][3]={{0,0,0},{0,0,0},{0,0,0}};
+    if(n>0)
+        sphereCovariance(&x[0], &y[0], &z[0], n, center, radius, residual, cov);
+
+    detection.valid=true;
+    detection.point.x=center[0];
+    detection.point.y=center[1];
+    detection.point.z=center[2];
+    detection.inliers=n;
+    detection.residual=residual;
+    setDetectionCovariance(detection, cov);
+}
+
+/**
+@brief SphereCentroid message matching a detection
+@param[in] detection detection message
+@return geometry_msgs::PointStamped ball center, -999 if the ball was not detected
+*/
+geometry_msgs::PointStamped detectionCentroid(const calibration_gui::SphereDetection& detection)
+{
+    geometry_msgs::PointStamped centroid;
+    centroid.header=detection.header;
+    centroid.point=detection.point;
+    return centroid;
+}
@@ -0,0 +1,591 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  sphere_fitting.cpp
+ \brief Algebraic circle fits (Kasa and Taubin) from moment accumulators and known-radius sphere fitting
+ \date   October, 2026
+*/
+
+#include "calibration_gui/sphere_fitting.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+/** Number of moments with p+q<=4 */
+#define NUM_MOMENTS 15
+/** Number of partial sums accumulated side by side in the batch add */
+#define MOMENT_LANES 4
+
+static const int momentP[NUM_MOMENTS] = {0, 1,0, 2,1,0, 3,2,1,0, 4,3,2,1,0};
+static const int momentQ[NUM_MOMENTS] = {0, 0,1, 0,1,2, 0,1,2,3, 0,1,2,3,4};
+
+/**
+@brief CircleMoments constructor
+@param[in] x0 x coordinate of the origin of the moments
+@param[in] y0 y coordinate of the origin of the moments
+*/
+CircleMoments::CircleMoments(double x0, double y0)
+{
+    origin[0]=x0;
+    origin[1]=y0;
+    clear();
+}
+
+/**
+@brief Resets the accumulated moments, keeping the origin
+@return void
+*/
+void CircleMoments::clear()
+{
+    memset(S, 0, sizeof(S));
+}
+
+/**
+@brief Adds a point to the accumulator
+@param[in] x x coordinate of the point
+@param[in] y y coordinate of the point
+@return void
+*/
+void CircleMoments::add(double x, double y)
+{
+    double u=x-origin[0], v=y-origin[1];
+    double up[5], vp[5];
+    up[0]=1; vp[0]=1;
+    for(int i=1; i<5; i++)
+    {
+        up[i]=up[i-1]*u;
+        vp[i]=vp[i-1]*v;
+    }
+    for(int k=0; k<NUM_MOMENTS; k++)
+        S[momentP[k]][momentQ[k]]+=up[momentP[k]]*vp[momentQ[k]];
+}
+
+/**
+@brief Adds a batch of points to the accumulator.
+Points are processed in groups of MOMENT_LANES with independent partial sums, so the products of a group
+can be evaluated with SIMD instructions without reordering the floating point additions of each lane
+@param[in] x x coordinates of the points
+@param[in] y y coordinates of the points
+@param[in] n number of points
+@return void
+*/
+void CircleMoments::add(const double* x, const double* y, size_t n)
+{
+    double lane[NUM_MOMENTS][MOMENT_LANES];
+    memset(lane, 0, sizeof(lane));
+
+    size_t blocks=n/MOMENT_LANES;
+    for(size_t b=0; b<blocks; b++)
+    {
+        double u[MOMENT_LANES], v[MOMENT_LANES], uu[MOMENT_LANES], vv[MOMENT_LANES];
+        for(int l=0; l<MOMENT_LANES; l++)
+        {
+            u[l]=x[b*MOMENT_LANES+l]-origin[0];
+            v[l]=y[b*MOMENT_LANES+l]-origin[1];
+            uu[l]=u[l]*u[l];
+            vv[l]=v[l]*v[l];
+        }
+        for(int l=0; l<MOMENT_LANES; l++)
+        {
+            lane[0][l]+=1;
+            lane[1][l]+=u[l];
+            lane[2][l]+=v[l];
+            lane[3][l]+=uu[l];
+            lane[4][l]+=u[l]*v[l];
+            lane[5][l]+=vv[l];
+            lane[6][l]+=uu[l]*u[l];
+            lane[7][l]+=uu[l]*v[l];
+            lane[8][l]+=u[l]*vv[l];
+            lane[9][l]+=vv[l]*v[l];
+            lane[10][l]+=uu[l]*uu[l];
+            lane[11][l]+=uu[l]*u[l]*v[l];
+            lane[12][l]+=uu[l]*vv[l];
+            lane[13][l]+=u[l]*vv[l]*v[l];
+            lane[14][l]+=vv[l]*vv[l];
+        }
+    }
+
+    for(int k=0; k<NUM_MOMENTS; k++)
+        for(int l=0; l<MOMENT_LANES; l++)
+            S[momentP[k]][momentQ[k]]+=lane[k][l];
+
+    for(size_t i=blocks*MOMENT_LANES; i<n; i++)
+        add(x[i], y[i]);
+}
+
+/**
+@brief Merges the moments of another accumulator built around the same origin
+@param[in] other accumulator to merge
+@return CircleMoments& this accumulator
+*/
+CircleMoments& CircleMoments::operator+=(const CircleMoments& other)
+{
+    for(int k=0; k<NUM_MOMENTS; k++)
+        S[momentP[k]][momentQ[k]]+=other.S[momentP[k]][momentQ[k]];
+    return *this;
+}
+
+/**
+@brief Central moments of the accumulated points, normalized by the number of points
+@param[out] mean_x x coordinate of the centroid
+@param[out] mean_y y coordinate of the centroid
+@param[out] M M[p][q] = mean of (x-mean_x)^p*(y-mean_y)^q, for p+q<=4
+@return void
+*/
+void CircleMoments::centralMoments(double& mean_x, double& mean_y, double M[5][5]) const
+{
+    static const double binomial[5][5] = {{1,0,0,0,0},{1,1,0,0,0},{1,2,1,0,0},{1,3,3,1,0},{1,4,6,4,1}};
+
+    double n=S[0][0];
+    double mu=S[1][0]/n, mv=S[0][1]/n;
+    double mup[5], mvp[5];
+    mup[0]=1; mvp[0]=1;
+    for(int i=1; i<5; i++)
+    {
+        mup[i]=-mup[i-1]*mu;
+        mvp[i]=-mvp[i-1]*mv;
+    }
+
+    memset(M, 0, sizeof(double)*25);
+    for(int k=0; k<NUM_MOMENTS; k++)
+    {
+        int p=momentP[k], q=momentQ[k];
+        double m=0;
+        for(int i=0; i<=p; i++)
+            for(int j=0; j<=q; j++)
+                m+=binomial[p][i]*binomial[q][j]*mup[p-i]*mvp[q-j]*S[i][j];
+        M[p][q]=m/n;
+    }
+
+    mean_x=mu+origin[0];
+    mean_y=mv+origin[1];
+}
+
+/**
+@brief RMS distance of the points to a circle, computed from the central moments.
+Uses the algebraic distance (d^2-R^2)/(2R), which matches the geometric distance for points close to the circle
+@param[in] M central moments
+@param[in] a x coordinate of the circle center, relative to the centroid
+@param[in] b y coordinate of the circle center, relative to the centroid
+@param[in] R circle radius
+@return double RMS distance
+*/
+static double circleResidual(const double M[5][5], double a, double b, double R)
+{
+    double K=a*a+b*b-R*R;
+    double Ez=M[2][0]+M[0][2];
+    double Ezz=M[4][0]+2*M[2][2]+M[0][4];
+    double Exz=M[3][0]+M[1][2];
+    double Eyz=M[2][1]+M[0][3];
+
+    double f2 = Ezz + 4*a*a*M[2][0] + 4*b*b*M[0][2] + K*K - 4*a*Exz - 4*b*Eyz + 2*K*Ez + 8*a*b*M[1][1];
+    if(R<=0)
+        return 0;
+    return sqrt(std::max(f2, 0.0))/(2*R);
+}
+
+/**
+@brief Inverse of a small square matrix (Gauss-Jordan with partial pivoting)
+@param[in] A row-major matrix, n<=4
+@param[in] n matrix size
+@param[out] inv row-major inverse
+@return true on success, false if the matrix is singular
+*/
+static bool invertMatrix(const double* A, int n, double* inv)
+{
+    double M[4][8];
+    for(int i=0; i<n; i++)
+        for(int j=0; j<n; j++)
+        {
+            M[i][j]=A[i*n+j];
+            M[i][j+n]= i==j ? 1 : 0;
+        }
+
+    for(int c=0; c<n; c++)
+    {
+        int pivot=c;
+        for(int r=c+1; r<n; r++)
+            if(fabs(M[r][c])>fabs(M[pivot][c]))
+                pivot=r;
+        if(fabs(M[pivot][c])<1e-15)
+            return false;
+        if(pivot!=c)
+            for(int j=0; j<2*n; j++)
+                std::swap(M[c][j], M[pivot][j]);
+
+        double d=M[c][c];
+        for(int j=0; j<2*n; j++)
+            M[c][j]/=d;
+        for(int r=0; r<n; r++)
+        {
+            if(r==c || M[r][c]==0)
+                continue;
+            double f=M[r][c];
+            for(int j=0; j<2*n; j++)
+                M[r][j]-=f*M[c][j];
+        }
+    }
+
+    for(int i=0; i<n; i++)
+        for(int j=0; j<n; j++)
+            inv[i*n+j]=M[i][j+n];
+    return true;
+}
+
+/**
+@brief Covariance of a fitted circle, sigma^2*(J'J)^-1 of the geometric distance, with J'J computed from the central moments.
+Short arcs give a nearly singular J'J, so the covariance grows as the visible arc of the ball shrinks
+@param[in] M central moments
+@param[in] a x coordinate of the circle center, relative to the centroid
+@param[in] b y coordinate of the circle center, relative to the centroid
+@param[in,out] fit fitted circle, with the radius, residual and number of points set. Its covariance is filled
+@return void
+*/
+static void circleCovariance(const double M[5][5], double a, double b, CircleFit& fit)
+{
+    double n=fit.points, R=fit.radius;
+    double JtJ[9] = { n*(M[2][0]+a*a)/(R*R), n*(M[1][1]+a*b)/(R*R), -n*a/R,
+                      n*(M[1][1]+a*b)/(R*R), n*(M[0][2]+b*b)/(R*R), -n*b/R,
+                      -n*a/R,                -n*b/R,                n };
+
+    // unbiased variance of the residuals, 3 parameters were fitted
+    double sigma2=fit.residual*fit.residual*(n>3 ? n/(n-3) : 1);
+
+    double inv[9];
+    if(R<=0 || !invertMatrix(JtJ, 3, inv))
+        return;
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            fit.covariance[i][j]=sigma2*inv[i*3+j];
+}
+
+/**
+@brief Kasa circle fit (algebraic fit of x^2+y^2+Dx+Ey+F=0)
+@param[in] moments accumulated moments of the points
+@param[out] fit fitted circle
+@return true on success, false if there are less than 3 points or they are collinear
+*/
+bool fitCircleKasa(const CircleMoments& moments, CircleFit& fit)
+{
+    fit.points=moments.count();
+    if(fit.points<3)
+        return false;
+
+    double mean_x, mean_y, M[5][5];
+    moments.centralMoments(mean_x, mean_y, M);
+
+    double Mxz=M[3][0]+M[1][2];
+    double Myz=M[2][1]+M[0][3];
+    double det=M[2][0]*M[0][2]-M[1][1]*M[1][1];
+    if(det==0 || !std::isfinite(det))
+        return false;
+
+    double a=0.5*(Mxz*M[0][2]-Myz*M[1][1])/det;
+    double b=0.5*(Myz*M[2][0]-Mxz*M[1][1])/det;
+
+    fit.x=a+mean_x;
+    fit.y=b+mean_y;
+    fit.radius=sqrt(a*a+b*b+M[2][0]+M[0][2]);
+    fit.residual=circleResidual(M, a, b, fit.radius);
+    circleCovariance(M, a, b, fit);
+    return true;
+}
+
+/**
+@brief Taubin circle fit. Less biased than the Kasa fit on short arcs, which is the case of a ball seen by a laser.
+Follows the Newton-based implementation of N. Chernov
+@param[in] moments accumulated moments of the points
+@param[out] fit fitted circle
+@return true on success, false if there are less than 3 points or they are collinear
+*/
+bool fitCircleTaubin(const CircleMoments& moments, CircleFit& fit)
+{
+    fit.points=moments.count();
+    if(fit.points<3)
+        return false;
+
+    double mean_x, mean_y, M[5][5];
+    moments.centralMoments(mean_x, mean_y, M);
+
+    double Mxx=M[2][0], Myy=M[0][2], Mxy=M[1][1];
+    double Mxz=M[3][0]+M[1][2];
+    double Myz=M[2][1]+M[0][3];
+    double Mzz=M[4][0]+2*M[2][2]+M[0][4];
+
+    double Mz=Mxx+Myy;
+    double Cov_xy=Mxx*Myy-Mxy*Mxy;
+    double Var_z=Mzz-Mz*Mz;
+
+    // coefficients of the characteristic polynomial
+    double A3=4*Mz;
+    double A2=-3*Mz*Mz-Mzz;
+    double A1=Var_z*Mz+4*Cov_xy*Mz-Mxz*Mxz-Myz*Myz;
+    double A0=Mxz*(Mxz*Myy-Myz*Mxy)+Myz*(Myz*Mxx-Mxz*Mxy)-Var_z*Cov_xy;
+    double A22=A2+A2;
+    double A33=A3+A3+A3;
+
+    // Newton's method starting at x=0, always converges to the right root
+    double x=0, y=A0;
+    for(int iter=0; iter<20; iter++)
+    {
+        double Dy=A1+x*(A22+A33*x);
+        double xnew=x-y/Dy;
+        if(xnew==x || !std::isfinite(xnew))
+            break;
+        double ynew=A0+xnew*(A1+xnew*(A2+xnew*A3));
+        if(fabs(ynew)>=fabs(y))
+            break;
+        x=xnew;
+        y=ynew;
+    }
+
+    double det=x*x-x*Mz+Cov_xy;
+    if(det==0 || !std::isfinite(det))
+        return false;
+
+    double a=(Mxz*(Myy-x)-Myz*Mxy)/det/2;
+    double b=(Myz*(Mxx-x)-Mxz*Mxy)/det/2;
+
+    fit.x=a+mean_x;
+    fit.y=b+mean_y;
+    fit.radius=sqrt(a*a+b*b+Mz);
+    fit.residual=circleResidual(M, a, b, fit.radius);
+    circleCovariance(M, a, b, fit);
+    return true;
+}
+
+/**
+@brief Distance from the center of a sphere of known radius to the plane of one of its circular sections
+@param[in] circleRadius radius of the circular section
+@param[in] sphereRadius radius of the sphere
+@return double distance between the sphere center and the section plane, 0 if the section is larger than the sphere
+*/
+double sphereOffsetFromCircle(double circleRadius, double sphereRadius)
+{
+    double d=sphereRadius*sphereRadius-circleRadius*circleRadius;
+    if(d<0)
+        d=0;
+    return sqrt(d);
+}
+
+/**
+@brief Covariance of the sphere center recovered from a circular section, in the frame of the section
+(x, y on the section plane, z along its normal). The offset is propagated with dz/dR = -R/z; near the
+equator this derivative diverges, so z is bounded below by sqrt(2*sphereRadius*sigma_R), the offset a
+one sigma error on the radius produces there
+@param[in] circle fitted circle, with its covariance
+@param[in] sphereRadius radius of the sphere
+@param[out] cov covariance of the sphere center
+@return void
+*/
+void sphereCovarianceFromCircle(const CircleFit& circle, double sphereRadius, double cov[3][3])
+{
+    double offset=sphereOffsetFromCircle(circle.radius, sphereRadius);
+    double minimum=sqrt(2*sphereRadius*sqrt(std::max(circle.covariance[2][2], 0.0)));
+    offset=std::max(offset, minimum);
+
+    double J[3]={1, 1, offset>0 ? -circle.radius/offset : 0};
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            cov[i][j]=J[i]*J[j]*circle.covariance[i][j];
+}
+
+/**
+@brief Residual and center covariance of a sphere fitted to a set of points, in a single pass over the points.
+The radius is treated as a free parameter, like in the RANSAC sphere model, and marginalized out
+@param[in] x x coordinates of the points
+@param[in] y y coordinates of the points
+@param[in] z z coordinates of the points
+@param[in] n number of points
+@param[in] center sphere center
+@param[in] radius sphere radius
+@param[out] residual RMS distance of the points to the sphere
+@param[out] cov covariance of the sphere center
+@return true on success, false if there are less than 4 points or the problem is degenerate
+*/
+bool sphereCovariance(const double* x, const double* y, const double* z, size_t n, const double center[3], double radius,
+                      double& residual, double cov[3][3])
+{
+    residual=0;
+    if(n<4)
+        return false;
+
+    // J'J of the geometric distance, J = [-(p-c)/|p-c|, -1]
+    double JtJ[16];
+    memset(JtJ, 0, sizeof(JtJ));
+    double sum2=0;
+    for(size_t i=0; i<n; i++)
+    {
+        double dx=x[i]-center[0], dy=y[i]-center[1], dz=z[i]-center[2];
+        double d=sqrt(dx*dx+dy*dy+dz*dz);
+        if(d==0)
+            continue;
+        double J[4]={-dx/d, -dy/d, -dz/d, -1};
+        for(int a=0; a<4; a++)
+            for(int b=0; b<4; b++)
+                JtJ[a*4+b]+=J[a]*J[b];
+        sum2+=(d-radius)*(d-radius);
+    }
+    residual=sqrt(sum2/n);
+
+    double inv[16];
+    if(!invertMatrix(JtJ, 4, inv))
+        return false;
+
+    // unbiased variance of the residuals, 4 parameters were fitted
+    double sigma2=sum2/(n>4 ? n-4 : 1);
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            cov[i][j]=sigma2*inv[i*4+j];
+    return true;
+}
+
+/**
+@brief Algebraic sphere fit (least squares on x^2+y^2+z^2 = 2ax+2by+2cz+d), with the points relative to their centroid
+@param[in] x x coordinates of the points
+@param[in] y y coordinates of the points
+@param[in] z z coordinates of the points
+@param[in] n number of points
+@param[out] center sphere center
+@param[out] radius sphere radius
+@return true on success, false if there are less than 4 points or the points are coplanar
+*/
+bool fitSphere(const double* x, const double* y, const double* z, size_t n, double center[3], double& radius)
+{
+    if(n<4)
+        return false;
+
+    double m[3]={0,0,0};
+    for(size_t i=0; i<n; i++)
+    {
+        m[0]+=x[i];
+        m[1]+=y[i];
+        m[2]+=z[i];
+    }
+    for(int a=0; a<3; a++)
+        m[a]/=n;
+
+    // normal equations of [2u 2v 2w 1]*[a b c d]' = u^2+v^2+w^2
+    double A[16], g[4]={0,0,0,0};
+    memset(A, 0, sizeof(A));
+    for(size_t i=0; i<n; i++)
+    {
+        double u=x[i]-m[0], v=y[i]-m[1], w=z[i]-m[2];
+        double r[4]={2*u, 2*v, 2*w, 1};
+        double q=u*u+v*v+w*w;
+        for(int a=0; a<4; a++)
+        {
+            g[a]+=r[a]*q;
+            for(int b=0; b<4; b++)
+                A[a*4+b]+=r[a]*r[b];
+        }
+    }
+
+    double inv[16];
+    if(!invertMatrix(A, 4, inv))
+        return false;
+
+    double p[4];
+    for(int a=0; a<4; a++)
+        p[a]=inv[a*4]*g[0]+inv[a*4+1]*g[1]+inv[a*4+2]*g[2]+inv[a*4+3]*g[3];
+
+    double r2=p[3]+p[0]*p[0]+p[1]*p[1]+p[2]*p[2];
+    if(r2<=0)
+        return false;
+
+    for(int a=0; a<3; a++)
+        center[a]=p[a]+m[a];
+    radius=sqrt(r2);
+    return true;
+}
+
+/**
+@brief Sphere fit with known radius (Gauss-Newton on the geometric distance)
+@param[in] x x coordinates of the points
+@param[in] y y coordinates of the points
+@param[in] z z coordinates of the points
+@param[in] n number of points
+@param[in] radius known radius of the sphere
+@param[in,out] center initial guess of the sphere center, refined on output. With a known radius, the points of a
+visible cap are also fitted by a sphere mirrored about them, so the guess must lie behind the surface as seen from the sensor
+@param[in] iterations maximum number of Gauss-Newton iterations
+@return true on success, false if there are less than 3 points or the problem is degenerate
+*/
+bool fitSphereKnownRadius(const double* x, const double* y, const double* z, size_t n, double radius,
+                          double center[3], int iterations)
+{
+    if(n<3)
+        return false;
+
+    for(int it=0; it<iterations; it++)
+    {
+        // normal equations J'J*delta = -J'r, with J = -(p-c)/|p-c| and r = |p-c|-radius
+        double A[3][3]={{0,0,0},{0,0,0},{0,0,0}}, g[3]={0,0,0};
+        for(size_t i=0; i<n; i++)
+        {
+            double dx=x[i]-center[0], dy=y[i]-center[1], dz=z[i]-center[2];
+            double d=sqrt(dx*dx+dy*dy+dz*dz);
+            if(d==0)
+                continue;
+            double J[3]={-dx/d, -dy/d, -dz/d};
+            double r=d-radius;
+            for(int a=0; a<3; a++)
+            {
+                g[a]-=J[a]*r;
+                for(int b=0; b<3; b++)
+                    A[a][b]+=J[a]*J[b];
+            }
+        }
+
+        double det = A[0][0]*(A[1][1]*A[2][2]-A[1][2]*A[2][1])
+                     - A[0][1]*(A[1][0]*A[2][2]-A[1][2]*A[2][0])
+                     + A[0][2]*(A[1][0]*A[2][1]-A[1][1]*A[2][0]);
+        if(fabs(det)<1e-12)
+            return false;
+
+        // Cramer's rule
+        double delta[3];
+        for(int c=0; c<3; c++)
+        {
+            double B[3][3];
+            for(int a=0; a<3; a++)
+                for(int b=0; b<3; b++)
+                    B[a][b]= b==c ? g[a] : A[a][b];
+            delta[c] = (B[0][0]*(B[1][1]*B[2][2]-B[1][2]*B[2][1])
+                        - B[0][1]*(B[1][0]*B[2][2]-B[1][2]*B[2][0])
+                        + B[0][2]*(B[1][0]*B[2][1]-B[1][1]*B[2][0]))/det;
+        }
+
+        center[0]+=delta[0];
+        center[1]+=delta[1];
+        center[2]+=delta[2];
+
+        if(fabs(delta[0])+fabs(delta[1])+fabs(delta[2])<1e-9)
+            break;
+    }
+    return true;
+}
@@ -0,0 +1,471 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  sphere_ransac.cpp
+ \brief RANSAC sphere detection with the known radius of the ball
+ \date   October, 2026
+*/
+
+#include "calibration_gui/sphere_ransac.h"
+#include "calibration_gui/sphere_fitting.h"
+#include <cmath>
+#include <limits>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+/**
+@brief SphereRansac constructor
+@param[in] radius known radius of the ball
+@param[in] threshold largest distance of an inlier to the sphere surface
+@param[in] maxIterations largest number of samples drawn
+@param[in] probability probability of drawing at least one sample free of outliers, sets the adaptive number of iterations
+*/
+SphereRansac::SphereRansac(double radius, double threshold, int maxIterations, double probability)
+{
+    this->radius=radius;
+    this->threshold=threshold;
+    this->maxIterations=maxIterations;
+    this->probability=probability;
+    seed=2463534242u;
+    threads=1;
+    lastHypotheses=0;
+    n=0;
+    nextBatch=0;
+    pool=NULL;
+    generation=0;
+    roundStart=0;
+    roundBatches=1;
+    pending=0;
+    stopping=false;
+    results.resize(1);
+}
+
+/**
+@brief SphereRansac destructor, ends the workers
+*/
+SphereRansac::~SphereRansac()
+{
+    stopPool();
+}
+
+/**
+@brief Sets the number of threads scoring hypotheses, restarting the workers
+@param[in] threads number of threads, 0 for one per core
+@return void
+*/
+void SphereRansac::setThreads(int threads)
+{
+    if(threads<=0)
+        threads=boost::thread::hardware_concurrency();
+    stopPool();
+    this->threads=max(threads, 1);
+    results.resize(this->threads);
+    startPool();
+}
+
+/**
+@brief Starts a worker for each thread but the one calling segment
+@return void
+*/
+void SphereRansac::startPool()
+{
+    if(threads<2)
+        return;
+    stopping=false;
+    pool=new boost::thread_group;
+    for(int t=1; t<threads; t++)
+        pool->create_thread(boost::bind(&SphereRansac::worker, this, t, generation));
+}
+
+/**
+@brief Ends the workers and waits for them
+@return void
+*/
+void SphereRansac::stopPool()
+{
+    if(!pool)
+        return;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        stopping=true;
+    }
+    work.notify_all();
+    pool->join_all();
+    delete pool;
+    pool=NULL;
+}
+
+/**
+@brief Copies the finite points of a cloud to the x, y and z arrays
+@param[in] cloud point cloud, in the frame of the sensor
+@return void
+*/
+void SphereRansac::setInputCloud(const pcl::PointCloud<pcl::PointXYZ>& cloud)
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    indices.clear();
+    for(size_t i=0; i<cloud.points.size(); i++)
+    {
+        const pcl::PointXYZ& p=cloud.points[i];
+        if(!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+            continue;
+        x.push_back(p.x);
+        y.push_back(p.y);
+        z.push_back(p.z);
+        indices.push_back(i);
+    }
+    n=indices.size();
+
+    // NaN fails both bounds of the inlier test, so the padding is never counted
+    size_t padded=(n+7)/8*8;
+    x.resize(padded, numeric_limits<float>::quiet_NaN());
+    y.resize(padded, numeric_limits<float>::quiet_NaN());
+    z.resize(padded, numeric_limits<float>::quiet_NaN());
+}
+
+/**
+@brief xorshift32 generator
+@param[in,out] state generator state, not 0
+@return pseudo random number
+*/
+static unsigned nextRandom(unsigned& state)
+{
+    state^=state<<13;
+    state^=state>>17;
+    state^=state<<5;
+    return state;
+}
+
+/**
+@brief Number of points within the threshold of the sphere surface
+@param[in] center sphere center
+@return number of inliers
+*/
+size_t SphereRansac::countInliers(const float center[3]) const
+{
+    float lo=max(radius-threshold, 0.0), hi=radius+threshold;
+    lo*=lo;
+    hi*=hi;
+
+    size_t count=0;
+#ifdef __AVX__
+    __m256 cx=_mm256_set1_ps(center[0]), cy=_mm256_set1_ps(center[1]), cz=_mm256_set1_ps(center[2]);
+    __m256 lo8=_mm256_set1_ps(lo), hi8=_mm256_set1_ps(hi);
+    for(size_t i=0; i<x.size(); i+=8)
+    {
+        __m256 dx=_mm256_sub_ps(_mm256_loadu_ps(&x[i]), cx);
+        __m256 dy=_mm256_sub_ps(_mm256_loadu_ps(&y[i]), cy);
+        __m256 dz=_mm256_sub_ps(_mm256_loadu_ps(&z[i]), cz);
+        __m256 d2=_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 in=_mm256_and_ps(_mm256_cmp_ps(d2, lo8, _CMP_GE_OQ), _mm256_cmp_ps(d2, hi8, _CMP_LE_OQ));
+        count+=__builtin_popcount(_mm256_movemask_ps(in));
+    }
+#else
+    for(size_t i=0; i<n; i++)
+    {
+        float dx=x[i]-center[0], dy=y[i]-center[1], dz=z[i]-center[2];
+        float d2=dx*dx+dy*dy+dz*dz;
+        count+= d2>=lo && d2<=hi;
+    }
+#endif
+    return count;
+}
+
+/**
+@brief Points within the threshold of the sphere surface, same test as countInliers
+@param[in] center sphere center
+@param[out] inliers indices of the inliers in the input cloud
+@param[out] ix x coordinates of the inliers
+@param[out] iy y coordinates of the inliers
+@param[out] iz z coordinates of the inliers
+@return void
+*/
+void SphereRansac::selectInliers(const float center[3], vector<int>& inliers, vector<double>& ix, vector<double>& iy,
+                                 vector<double>& iz) const
+{
+    float lo=max(radius-threshold, 0.0), hi=radius+threshold;
+    lo*=lo;
+    hi*=hi;
+
+    inliers.clear();
+    ix.clear();
+    iy.clear();
+    iz.clear();
+    for(size_t i=0; i<n; i++)
+    {
+        float dx=x[i]-center[0], dy=y[i]-center[1], dz=z[i]-center[2];
+        float d2=dx*dx+dy*dy+dz*dz;
+        if(d2>=lo && d2<=hi)
+        {
+            inliers.push_back(indices[i]);
+            ix.push_back(x[i]);
+            iy.push_back(y[i]);
+            iz.push_back(z[i]);
+        }
+    }
+}
+
+/**
+@brief Center of the sphere through 3 random points
+@param[in,out] state generator state of the samples
+@param[out] center sphere center, on the side of the points away from the sensor
+@return false if the sample is degenerate or the points do not fit on a ball this size
+*/
+bool SphereRansac::hypothesis(unsigned& state, float center[3]) const
+{
+    size_t i0=nextRandom(state)%n, i1=nextRandom(state)%n, i2=nextRandom(state)%n;
+    if(i0==i1 || i0==i2 || i1==i2)
+        return false;
+
+    double a[3]={x[i0], y[i0], z[i0]};
+    double u[3]={x[i1]-a[0], y[i1]-a[1], z[i1]-a[2]};
+    double v[3]={x[i2]-a[0], y[i2]-a[1], z[i2]-a[2]};
+    double w[3]={u[1]*v[2]-u[2]*v[1], u[2]*v[0]-u[0]*v[2], u[0]*v[1]-u[1]*v[0]};
+    double u2=u[0]*u[0]+u[1]*u[1]+u[2]*u[2];
+    double v2=v[0]*v[0]+v[1]*v[1]+v[2]*v[2];
+    double w2=w[0]*w[0]+w[1]*w[1]+w[2]*w[2];
+    if(w2<1e-12*u2*v2) // collinear
+        return false;
+
+    // circumcenter a + (|u|^2 (v x w) + |v|^2 (w x u)) / (2|w|^2)
+    double vw[3]={v[1]*w[2]-v[2]*w[1], v[2]*w[0]-v[0]*w[2], v[0]*w[1]-v[1]*w[0]};
+    double wu[3]={w[1]*u[2]-w[2]*u[1], w[2]*u[0]-w[0]*u[2], w[0]*u[1]-w[1]*u[0]};
+    double cc[3], rc2=0;
+    for(int k=0; k<3; k++)
+    {
+        double o=(u2*vw[k]+v2*wu[k])/(2*w2);
+        rc2+=o*o;
+        cc[k]=a[k]+o;
+    }
+    double R2=radius*radius;
+    if(rc2>R2)
+        return false;
+
+    // along the axis of the circle, away from the sensor
+    double h=sqrt((R2-rc2)/w2);
+    if(cc[0]*w[0]+cc[1]*w[1]+cc[2]*w[2]<0)
+        h=-h;
+    for(int k=0; k<3; k++)
+        center[k]=cc[k]+h*w[k];
+    return true;
+}
+
+/**
+@brief Scores a batch of samples.
+Each batch has its own generator, seeded from the batch number, so a batch draws the same samples whichever
+thread runs it
+@param[in] batch batch number
+@param[out] result best model of the batch, ties going to the first sample
+@return void
+*/
+void SphereRansac::evaluate(int batch, BatchResult& result) const
+{
+    unsigned state=seed^(2654435769u*(batch+1));
+    if(state==0)
+        state=seed;
+    for(int k=0; k<4; k++)
+        nextRandom(state);
+
+    result.inliers=0;
+    result.hypotheses=0;
+    for(int c=0; c<3; c++)
+        result.center[c]=0;
+    for(int k=0; k<RANSAC_BATCH; k++)
+    {
+        float center[3];
+        if(!hypothesis(state, center))
+            continue;
+        result.hypotheses++;
+        size_t count=countInliers(center);
+        if(count>result.inliers)
+        {
+            result.inliers=count;
+            for(int c=0; c<3; c++)
+                result.center[c]=center[c];
+        }
+    }
+}
+
+/**
+@brief Worker of the pool. Scores batches roundStart+slot*roundBatches to roundStart+(slot+1)*roundBatches-1 of
+every round, until the pool is stopped
+@param[in] slot index of the thread, 1 to threads-1 (the caller of segment is 0)
+@param[in] generation rounds started before the worker, which it must not run
+@return void
+*/
+void SphereRansac::worker(int slot, int generation)
+{
+    while(true)
+    {
+        int start, first, count;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while(this->generation==generation && !stopping)
+                work.wait(lock);
+            if(stopping)
+                return;
+            generation=this->generation;
+            start=roundStart;
+            count=roundBatches;
+            first=slot*count;
+        }
+
+        for(int k=first; k<first+count; k++)
+            evaluate(start+k, results[k]);
+
+        boost::mutex::scoped_lock lock(mutex);
+        if(--pending==0)
+            done.notify_one();
+    }
+}
+
+/**
+@brief Detects the sphere of known radius with most inliers.
+The best center is refined by a known radius fit to its inliers. The radius returned is the one of an unconstrained fit
+to the same inliers, so the caller can still check that the inliers form a sphere of the ball size
+(e.g. a flat surface also has inliers, on the disc where it touches the sphere)
+@param[out] sphere center and unconstrained radius of the sphere
+@param[out] inliers indices of the inliers in the input cloud
+@return true if a sphere with at least 4 inliers was found
+*/
+bool SphereRansac::segment(double sphere[4], vector<int>& inliers)
+{
+    inliers.clear();
+    lastHypotheses=0;
+    nextBatch=0;
+    if(n<4)
+        return false;
+
+    best=0;
+    required=maxIterations;
+    int size=1;
+    while(nextBatch*RANSAC_BATCH<min(required, (double)maxIterations))
+    {
+        // a round: the same number of consecutive batches for each thread, this one included. Waking the workers
+        // and waiting for them can cost more than a batch of a small cloud, so the rounds are sized from the time
+        // of a batch in the previous ones to take about RANSAC_ROUND, and cut to the batches still needed
+        int count=1;
+        if(pool)
+        {
+            int left=(int)ceil((min(required, (double)maxIterations)-nextBatch*RANSAC_BATCH)/RANSAC_BATCH);
+            count=max(min(size, (left+threads-1)/threads), 1);
+            if(results.size()<(size_t)(threads*count))
+                results.resize(threads*count);
+
+            boost::mutex::scoped_lock lock(mutex);
+            roundStart=nextBatch;
+            roundBatches=count;
+            pending=threads-1;
+            generation++;
+            work.notify_all();
+        }
+        boost::posix_time::ptime start=boost::posix_time::microsec_clock::universal_time();
+        for(int k=0; k<count; k++)
+            evaluate(nextBatch+k, results[k]);
+        if(pool)
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while(pending>0)
+                done.wait(lock);
+        }
+        double batchTime=(boost::posix_time::microsec_clock::universal_time()-start).total_microseconds()*1e-6/count;
+        size= batchTime>0 ? (int)min(RANSAC_ROUND/batchTime+1, (double)maxIterations) : 2*size;
+
+        // merged in batch order, up to the first batch a single thread would not have drawn
+        for(int t=0; t<threads*count && nextBatch*RANSAC_BATCH<min(required, (double)maxIterations); t++, nextBatch++)
+        {
+            const BatchResult& result=results[t];
+            lastHypotheses+=result.hypotheses;
+            if(result.inliers>best)
+            {
+                best=result.inliers;
+                for(int c=0; c<3; c++)
+                    bestCenter[c]=result.center[c];
+
+                // samples needed to draw 3 inliers with the given probability
+                double good=pow((double)best/n, 3);
+                required= good>=1 ? 0 : log(1-probability)/log(1-good);
+            }
+        }
+    }
+
+    if(best<4)
+        return false;
+
+    // known radius refinement of the center on its inliers, then the inliers of the refined center
+    vector<double> ix, iy, iz;
+    selectInliers(bestCenter, inliers, ix, iy, iz);
+    double center[3]={bestCenter[0], bestCenter[1], bestCenter[2]};
+    if(inliers.size()>=4 && fitSphereKnownRadius(&ix[0], &iy[0], &iz[0], ix.size(), radius, center))
+    {
+        for(int k=0; k<3; k++)
+            bestCenter[k]=center[k];
+        selectInliers(bestCenter, inliers, ix, iy, iz);
+    }
+
+    double unconstrained[3];
+    if(inliers.size()<4 || !fitSphere(&ix[0], &iy[0], &iz[0], ix.size(), unconstrained, sphere[3]))
+        return false;
+    for(int k=0; k<3; k++)
+        sphere[k]=center[k];
+    return true;
+}
+
+/**
+@brief Points of a cloud near the surface of a sphere, to refine at full resolution a sphere found on a coarse grid
+@param[in] cloud point cloud
+@param[in] center sphere center
+@param[in] radius sphere radius
+@param[in] margin largest distance of a point to the sphere surface
+@param[out] shell points within the margin of the surface, unorganized
+@return void
+*/
+void sphereShell(const pcl::PointCloud<pcl::PointXYZ>& cloud, const double center[3], double radius, double margin,
+                 pcl::PointCloud<pcl::PointXYZ>& shell)
+{
+    double lo=max(radius-margin, 0.0), hi=radius+margin;
+    lo*=lo;
+    hi*=hi;
+
+    shell.points.clear();
+    for(size_t i=0; i<cloud.points.size(); i++)
+    {
+        const pcl::PointXYZ& p=cloud.points[i];
+        double dx=p.x-center[0], dy=p.y-center[1], dz=p.z-center[2];
+        double d2=dx*dx+dy*dy+dz*dz;
+        if(d2>=lo && d2<=hi)
+            shell.points.push_back(p);
+    }
+    shell.width=shell.points.size();
+    shell.height=1;
+    shell.is_dense=true;
+}
@@ -0,0 +1,297 @@
+/**************************************************************************************************
+ Software License Agreement (BSD License)
+
+ Copyright (c) 2014-2015, LAR toolkit developers - University of Aveiro - http://lars.mec.ua.pt
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted
+ provided that the following conditions are met:
+
+  *Redistributions of source code must retain the above copyright notice, this list of
+   conditions and the following disclaimer.
+  *Redistributions in binary form must reproduce the above copyright notice, this list of
+   conditions and the following disclaimer in the documentation and/or other materials provided
+   with the distribution.
+  *Neither the name of the University of Aveiro nor the names of its contributors may be used to
+   endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************************************/
+/**
+ \file  sphere_ransac_benchmark.cpp
+ \brief Comparison of the known radius sphere RANSAC with the PCL sphere RANSAC on recorded clouds, and of the
+ coarse-to-fine search of the Kinect node with the single level search on a synthetic frame
+ \date   October, 2026
+ */
+
+#include "ros/ros.h"
+#include "calibration_gui/sphere_ransac.h"
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/sample_consensus/ransac.h>
+#include <pcl/sample_consensus/sac_model_sphere.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+
+using namespace std;
+
+/**
+  \class CountingRansac
+  \brief PCL RANSAC exposing the number of iterations of the last model computed
+ */
+class CountingRansac : public pcl::RandomSampleConsensus<pcl::PointXYZ>
+{
+public:
+    CountingRansac(const pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr &model, double threshold)
+    : pcl::RandomSampleConsensus<pcl::PointXYZ>(model, threshold) {}
+
+    int iterations() const { return iterations_; }
+};
+
+/**
+   @brief Gaussian noise, as the sum of 12 uniform samples
+   @param[in] sigma standard deviation
+   @return double noise sample
+ */
+double noise(double sigma)
+{
+	double sum = 0;
+	for(int i=0; i<12; i++)
+		sum += rand()/(double)RAND_MAX;
+	return (sum-6)*sigma;
+}
+
+/**
+   @brief Synthetic Kinect frame: the visible cap of the ball (30000 points) in front of a tilted wall (200000 points),
+   with 4 mm of noise on each coordinate
+   @param[in] radius ball radius
+   @param[in] center ball center
+   @param[out] cloud synthetic frame
+   @return void
+ */
+void syntheticFrame(double radius, const double center[3], pcl::PointCloud<pcl::PointXYZ>& cloud)
+{
+	cloud.points.clear();
+	for(int i=0; i<30000; i++)
+	{
+		double theta = acos(rand()/(double)RAND_MAX)*0.9, phi = 2*M_PI*rand()/RAND_MAX;
+		pcl::PointXYZ p;
+		p.x = center[0] + radius*sin(theta)*cos(phi) + noise(0.004);
+		p.y = center[1] + radius*sin(theta)*sin(phi) + noise(0.004);
+		p.z = center[2] - radius*cos(theta) + noise(0.004);
+		cloud.points.push_back(p);
+	}
+	for(int i=0; i<200000; i++)
+	{
+		pcl::PointXYZ p;
+		p.x = -2 + 4.0*rand()/RAND_MAX;
+		p.y = -1.5 + 3.0*rand()/RAND_MAX;
+		p.z = 4 + 0.5*p.x + noise(0.004);
+		cloud.points.push_back(p);
+	}
+	cloud.width = cloud.points.size();
+	cloud.height = 1;
+}
+
+/**
+   @brief Sphere search of the Kinect node: known radius RANSAC on a voxel grid, first on a coarse grid when coarseLeaf is
+   larger than leaf, falling back to the single level when the coarse grid is too small or has no sphere
+   @param[in] cloud input cloud
+   @param[in] radius ball radius
+   @param[in] leaf voxel size of the fine level
+   @param[in] coarseLeaf voxel size of the coarse level
+   @param[out] sphere center and radius of the sphere found
+   @return true if a sphere was found
+ */
+bool kinectSearch(const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud, double radius, double leaf, double coarseLeaf,
+                  double sphere[4])
+{
+	double threshold = 0.0070936;
+	pcl::VoxelGrid<pcl::PointXYZ> sor;
+	sor.setFilterFieldName ("z");
+	sor.setFilterLimits (0, 5);
+
+	pcl::PointCloud<pcl::PointXYZ>::Ptr fine_input = cloud;
+	if(coarseLeaf > leaf)
+	{
+		pcl::PointCloud<pcl::PointXYZ>::Ptr coarse (new pcl::PointCloud<pcl::PointXYZ>);
+		sor.setInputCloud (cloud);
+		sor.setLeafSize (coarseLeaf, coarseLeaf, coarseLeaf);
+		sor.filter (*coarse);
+
+		double coarseSphere[4];
+		vector<int> inliers;
+		SphereRansac coarseRansac(radius, max(threshold, coarseLeaf/4));
+		coarseRansac.setInputCloud(*coarse);
+		if(coarse->size() >= 100 && coarseRansac.segment(coarseSphere, inliers))
+		{
+			pcl::PointCloud<pcl::PointXYZ>::Ptr shell (new pcl::PointCloud<pcl::PointXYZ>);
+			sphereShell(*cloud, coarseSphere, radius, coarseLeaf, *shell);
+			fine_input = shell;
+		}
+	}
+
+	pcl::PointCloud<pcl::PointXYZ>::Ptr filtered (new pcl::PointCloud<pcl::PointXYZ>);
+	sor.setInputCloud (fine_input);
+	sor.setLeafSize (leaf, leaf, leaf);
+	sor.filter (*filtered);
+
+	SphereRansac ransac(radius, threshold);
+	ransac.setInputCloud(*filtered);
+	vector<int> inliers;
+	return ransac.segment(sphere, inliers);
+}
+
+/**
+   @brief Compares the coarse-to-fine search of the Kinect node (3 cm coarse grid) with the single level search on
+   synthetic frames, printing the mean time and center error of both
+   @param[in] radius ball radius
+   @param[in] leaf voxel size of the fine level
+   @param[in] trials number of synthetic frames
+   @return void
+ */
+void coarseToFineComparison(double radius, double leaf, int trials)
+{
+	double center[3] = {0.3, -0.2, 2.5};
+	double singleTime = 0, singleError = 0, coarseTime = 0, coarseError = 0;
+	int singleFound = 0, coarseFound = 0;
+	srand(3);
+	for(int t=0; t<trials; t++)
+	{
+		pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+		syntheticFrame(radius, center, *cloud);
+
+		double sphere[4];
+		ros::WallTime start = ros::WallTime::now();
+		if(kinectSearch(cloud, radius, leaf, 0, sphere))
+		{
+			singleFound++;
+			singleError += sqrt(pow(sphere[0]-center[0], 2) + pow(sphere[1]-center[1], 2) + pow(sphere[2]-center[2], 2));
+		}
+		singleTime += (ros::WallTime::now() - start).toSec();
+
+		start = ros::WallTime::now();
+		if(kinectSearch(cloud, radius, leaf, 0.03, sphere))
+		{
+			coarseFound++;
+			coarseError += sqrt(pow(sphere[0]-center[0], 2) + pow(sphere[1]-center[1], 2) + pow(sphere[2]-center[2], 2));
+		}
+		coarseTime += (ros::WallTime::now() - start).toSec();
+	}
+
+	printf("%-30s %8s | %10s %10s %8s | %10s %10s %8s\n", "synthetic", "trials",
+	       "single ms", "err mm", "found", "c2f ms", "err mm", "found");
+	printf("%-30s %8d | %10.3f %10.2f %8d | %10.3f %10.2f %8d\n", "ball cap + wall", trials,
+	       singleTime/trials*1e3, singleError/max(singleFound, 1)*1e3, singleFound,
+	       coarseTime/trials*1e3, coarseError/max(coarseFound, 1)*1e3, coarseFound);
+}
+
+/**
+   @brief Runs both detectors on each cloud, with the parameters of the Kinect and SwissRanger nodes
+   @param argc
+   @param argv ball diameter, voxel leaf size (0 to use the clouds as recorded), repetitions, threads of the known radius
+   RANSAC (0 for one per core), whose speedup over a single thread is printed, and the pcd files. A file named
+   "synthetic" runs instead the coarse-to-fine comparison, with 20 frames and the leaf size (5 mm if 0) as the fine level
+   @return int
+ */
+int main(int argc, char **argv)
+{
+	if(argc < 6)
+	{
+		cout << "Usage: sphere_ransac_benchmark <ball diameter> <leaf size> <repetitions> <threads> <cloud.pcd or synthetic>..." << endl;
+		return 1;
+	}
+
+	double radius = atof(argv[1])/2;
+	double leaf = atof(argv[2]);
+	int repetitions = max(atoi(argv[3]), 1);
+	int threads = atoi(argv[4]);
+	double threshold = 0.0070936;
+
+	printf("%-30s %8s | %10s %10s %12s %8s | %10s %10s %12s %8s %8s\n", "cloud", "points",
+	       "pcl ms", "iter", "hyp/s", "inliers", "known ms", "hyp", "hyp/s", "inliers", "speedup");
+
+	for(int f=5; f<argc; f++)
+	{
+		if(string(argv[f]) == "synthetic")
+		{
+			coarseToFineComparison(radius, leaf > 0 ? leaf : 0.005, 20);
+			continue;
+		}
+
+		pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+		if(pcl::io::loadPCDFile<pcl::PointXYZ>(argv[f], *cloud) < 0)
+			continue;
+
+		if(leaf > 0)
+		{
+			pcl::PointCloud<pcl::PointXYZ>::Ptr filtered (new pcl::PointCloud<pcl::PointXYZ>);
+			pcl::VoxelGrid<pcl::PointXYZ> sor;
+			sor.setInputCloud (cloud);
+			sor.setFilterFieldName ("z");
+			sor.setFilterLimits (0, 5);
+			sor.setLeafSize (leaf, leaf, leaf);
+			sor.filter (*filtered);
+			cloud = filtered;
+		}
+
+		// PCL sphere model with free radius, as in the nodes before the known radius RANSAC
+		double pclTime = 0, pclIterations = 0;
+		size_t pclInliers = 0;
+		for(int r=0; r<repetitions; r++)
+		{
+			ros::WallTime start = ros::WallTime::now();
+			pcl::SampleConsensusModelSphere<pcl::PointXYZ>::Ptr model (new pcl::SampleConsensusModelSphere<pcl::PointXYZ>(cloud));
+			model->setRadiusLimits (radius-0.05, radius+0.05);
+			CountingRansac sac(model, threshold);
+			sac.setMaxIterations (10000);
+			sac.setProbability (0.99);
+			sac.computeModel ();
+			vector<int> inliers;
+			sac.getInliers (inliers);
+			pclTime += (ros::WallTime::now() - start).toSec();
+			pclIterations += sac.iterations();
+			pclInliers = inliers.size();
+		}
+
+		// Known radius RANSAC on the threads asked for, and on a single thread for the speedup of the pool
+		double knownTime = 0, knownHypotheses = 0, singleTime = 0;
+		size_t knownInliers = 0;
+		SphereRansac ransac(radius, threshold), single(radius, threshold);
+		ransac.setThreads(threads);
+		for(int r=0; r<repetitions; r++)
+		{
+			ros::WallTime start = ros::WallTime::now();
+			ransac.setInputCloud(*cloud);
+			double sphere[4];
+			vector<int> inliers;
+			ransac.segment(sphere, inliers);
+			knownTime += (ros::WallTime::now() - start).toSec();
+			knownHypotheses += ransac.hypotheses();
+			knownInliers = inliers.size();
+
+			start = ros::WallTime::now();
+			single.setInputCloud(*cloud);
+			single.segment(sphere, inliers);
+			singleTime += (ros::WallTime::now() - start).toSec();
+		}
+
+		printf("%-30s %8zu | %10.3f %10.0f %12.0f %8zu | %10.3f %10.0f %12.0f %8zu %8.2f\n", argv[f], cloud->points.size(),
+		       pclTime/repetitions*1e3, pclIterations/repetitions, pclIterations/pclTime, pclInliers,
+		       knownTime/repetitions*1e3, knownHypotheses/repetitions, knownHypotheses/knownTime, knownInliers,
+		       singleTime/knownTime);
+	}
+
+	return 0;
+}
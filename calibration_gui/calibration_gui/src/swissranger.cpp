@@ -35,7 +35,7 @@
 #include <cmath>
 #include <algorithm>
 #include <geometry_msgs/Point32.h>
-#include <sensor_msgs/PointCloud.h>
+#include <sensor_msgs/PointCloud2.h>
 #include "calibration_gui/swissranger.h"
 #include <eigen3/Eigen/Dense>
 #include <pcl/point_types.h>
@@ -44,6 +44,12 @@
 #include <pcl/sample_consensus/sac_model_sphere.h>
 #include <pcl/io/pcd_io.h>
 #include "calibration_gui/visualization_rviz_swissranger.h"
+#include "calibration_gui/sphere_detection.h"
+#include "calibration_gui/sphere_ransac.h"
+#include "calibration_gui/frame_budget.h"
+#include "calibration_gui/organized_roi.h"
+#include "calibration_gui/depth_candidates.h"
+#include <pcl/common/io.h>
 #include <visualization_msgs/MarkerArray.h>
 #include <geometry_msgs/PointStamped.h>
 
@@ -57,7 +63,12 @@
 
 ros::Publisher markers_pub;
 ros::Publisher sphereCenter_pub;
+ros::Publisher sphereDetection_pub;
 ros::Publisher pointCloud_pub;
+ros::Publisher timing_pub;
+SphereRansac ransac(0);
+// The SwissRanger cloud is not downsampled, only the RANSAC iterations follow the budget
+FrameBudget budget(50);
 
 /**
    @brief write in a file the center of the sphere
@@ -73,18 +84,17 @@ void writeFile(Eigen::VectorXf sphereCoeffsRefined)
 
 /**
    @brief Detection of the ball on the sensor data
-   @param[in] SwissRanger_cloud point cloud from the swissranger
-   @return void
+   @param[in] SwissRanger_cloud point cloud from the swissranger (the full frame, a window or a candidate blob)
+   @param[out] sphere center and radius of the detected ball
+   @param[out] detection detected ball, not valid if the ball was not found
+   @return true if the ball was detected
  */
-void sphereDetection(pcl::PointCloud<pcl::PointXYZ> SwissRanger_cloud)
+bool sphereDetection(const pcl::PointCloud<pcl::PointXYZ> &SwissRanger_cloud, double sphere[4], calibration_gui::SphereDetection &detection)
 {
 
 	ros::Time start = ros::Time::now();
 
-	geometry_msgs::PointStamped sphereCenter;
-	sphereCenter.point.x = -999;
-	sphereCenter.point.y = -999;
-	sphereCenter.point.z = -999;
+	invalidDetection(detection);
 
 	/* METHOD #1 ================================================================
 	 * Detects the ball up to 2-2.5 meters, very slow
@@ -211,48 +221,45 @@ void sphereDetection(pcl::PointCloud<pcl::PointXYZ> SwissRanger_cloud)
 	/* METHOD #4 ================================================================
 	 * Detects the ball up to 3 meters, fast. Optimized Method #3
 	 */
-	pcl::PointCloud<pcl::PointXYZ>::Ptr SR_cloudPtr (new pcl::PointCloud<pcl::PointXYZ>(SwissRanger_cloud));
-
 	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_p (new pcl::PointCloud<pcl::PointXYZ>);
 
-	pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients ());
-	pcl::PointIndices::Ptr inliers (new pcl::PointIndices ());
-
-	// Create the segmentation object
-	pcl::SACSegmentation<pcl::PointXYZ> seg;
-	// Optional
-	seg.setOptimizeCoefficients (true);
-	// Mandatory
-	seg.setModelType (pcl::SACMODEL_SPHERE);
-	seg.setMethodType (pcl::SAC_RANSAC);
-	seg.setMaxIterations (10000);
-	seg.setDistanceThreshold (0.0070936);
-	seg.setProbability(0.99);
-	seg.setRadiusLimits (BALL_DIAMETER/2-0.05, BALL_DIAMETER/2+0.05);
-	seg.setInputCloud (SR_cloudPtr);
-	seg.segment (*inliers, *coefficients);
+	// Known radius RANSAC, the radius returned is fitted freely to the inliers to verify the ball size
+	ransac.setRadius(BALL_DIAMETER/2);
+	ransac.setInputCloud(SwissRanger_cloud);
+	ransac.setMaxIterations(budget.iterations(SwissRanger_cloud.size()));
+	vector<int> inliers;
+	ros::WallTime ransacStart = ros::WallTime::now();
+	bool found = ransac.segment(sphere, inliers);
+	budget.ransacDone(SwissRanger_cloud.size(), ransac.iterations(), (ros::WallTime::now() - ransacStart).toSec());
 
 	ros::Time end = ros::Time::now();
 
-	cout << "Ball detection time filtered: " <<  (end - start).toNSec() * 1e-6 << " msec"  << endl;
+	cout << "Ball detection time filtered: " <<  (end - start).toNSec() * 1e-6 << " msec, " << ransac.hypotheses() << " hypotheses" << endl;
 
-	cout << *coefficients << endl;
-
-	if(inliers->indices.size ()>0)
+	if(found)
 	{
-
-		if (coefficients->values[3]<BALL_DIAMETER/2 + 0.05*BALL_DIAMETER/2 && coefficients->values[3]>BALL_DIAMETER/2 - 0.05*BALL_DIAMETER/2)
+		if (sphere[3]<BALL_DIAMETER/2 + 0.05*BALL_DIAMETER/2 && sphere[3]>BALL_DIAMETER/2 - 0.05*BALL_DIAMETER/2)
 		{
-			sphereCenter.point.x = coefficients->values[0];
-			sphereCenter.point.y = coefficients->values[1];
-			sphereCenter.point.z = coefficients->values[2];
+			sphereDetectionFromInliers(SwissRanger_cloud, inliers, sphere, BALL_DIAMETER/2, detection);
 
-
-			cout << "Accepted: " << *coefficients << endl;
+			cout << "Accepted: " << sphere[0] << ", " << sphere[1] << ", " << sphere[2] << ", " << sphere[3] << endl;
 		}
 	}
 
-	sphereCenter.header.stamp = ros::Time::now();
+	return detection.valid;
+}
+
+/**
+   @brief Publishes the ball detected on a frame
+   @param[in] detection detected ball, not valid if the ball was not found
+   @return void
+ */
+void publishDetection(calibration_gui::SphereDetection &detection)
+{
+	detection.header.stamp = ros::Time::now();
+	sphereDetection_pub.publish(detection);
+
+	geometry_msgs::PointStamped sphereCenter = detectionCentroid(detection);
 	sphereCenter_pub.publish(sphereCenter);
 
 	pcl::PointXYZ center;
@@ -263,7 +270,6 @@ void sphereDetection(pcl::PointCloud<pcl::PointXYZ> SwissRanger_cloud)
 	visualization_msgs::MarkerArray targets_markers;
 	targets_markers.markers = createTargetMarkers(center);
 	markers_pub.publish(targets_markers);
-
 }
 
 /**
@@ -283,31 +289,106 @@ int main(int argc, char **argv)
 	cout << "Node namespace:" << node_ns << endl;
 	cout << "Ball diameter:" << BALL_DIAMETER << endl;
 
+	// Threads of the sphere RANSAC, 0 for one per core
+	int ransacThreads = 0;
+	n.getParam("ransacThreads", ransacThreads);
+	ransac.setThreads(ransacThreads);
+
+	// Frame rate of the sensor, sets the time budget of each frame
+	double sensorRate = 50;
+	n.getParam("sensorRate", sensorRate);
+	budget.setRate(sensorRate);
+
+	// Window around the last detection, as a fraction of the ball size. Negative to always search the full frame
+	double roiMargin = 0.5;
+	n.getParam("roiMargin", roiMargin);
+	OrganizedROI roi(roiMargin);
+
+	// Sphere fitting first on the depth blobs with the size of the ball, then on the whole window if none has it
+	bool blobCandidates = true;
+	n.getParam("blobCandidates", blobCandidates);
+	DepthBlobDetector blobs(BALL_DIAMETER);
+
+	// Frames between whole window searches when no blob has the ball size and the ball is not tracked, 1 for every frame
+	int fallbackInterval = 10;
+	n.getParam("fallbackInterval", fallbackInterval);
+	int framesWithoutFallback = 0;
+
 	markers_pub = n.advertise<visualization_msgs::MarkerArray>( "BallDetection", 10000);
 	sphereCenter_pub = n.advertise<geometry_msgs::PointStamped>("SphereCentroid",1000);
-	pointCloud_pub = n.advertise<sensor_msgs::PointCloud>("Pointcloud",10000);
+	sphereDetection_pub = n.advertise<calibration_gui::SphereDetection>("SphereDetection",1000);
+	pointCloud_pub = n.advertise<sensor_msgs::PointCloud2>("Pointcloud",10);
+	timing_pub = n.advertise<calibration_gui::DetectionTiming>("DetectionTiming",10);
 
-	swissranger cloud(node_ns);
+	// Pixels below these confidence and amplitude values are dropped before any fitting (raw 16 bit values, 0 keeps all).
+	// Both are off by default, since no threshold has been tuned on recorded frames yet
+	double minConfidence = 0, minAmplitude = 0;
+	n.getParam("minConfidence", minConfidence);
+	n.getParam("minAmplitude", minAmplitude);
+
+	swissranger cloud(node_ns, minConfidence, minAmplitude);
 
 	ros::Rate loop_rate(50);
 
+	// last cloud processed, the same frame is not searched twice
+	unsigned last_frame = 0;
+
 	while(ros::ok())
 	{
-		if(cloud.cloud.points.size()>0)
+		if(cloud.frames != last_frame && cloud.cloud->points.size()>0)
 		{
-			pcl::PointCloud<pcl::PointXYZ> SwissRanger_cloud;
-			pcl::PointXYZ p;
-			for(int i=0; i<cloud.cloud.points.size(); i++)
+			last_frame = cloud.frames;
+			budget.start();
+			ROS_DEBUG("%d pixels dropped for low confidence or amplitude", (int)cloud.rejected);
+
+			// The cloud is only copied when cropped or split into candidates
+			pcl::PointCloud<pcl::PointXYZ>::ConstPtr input = roiMargin >= 0 ? roi.crop(cloud.cloud) : cloud.cloud;
+
+			calibration_gui::SphereDetection detection;
+			invalidDetection(detection);
+			double sphere[4];
+			bool found = false;
+			vector<SphereCandidate> candidates;
+			if(blobCandidates)
 			{
-				p.x=cloud.cloud.points[i].x;
-				p.y=cloud.cloud.points[i].y;
-				p.z=cloud.cloud.points[i].z;
-				SwissRanger_cloud.push_back(p);
+				// Candidates are tried from the best size match, until one of them is a sphere
+				blobs.detect(*input, candidates);
+				pcl::PointCloud<pcl::PointXYZ> candidate;
+				for(int i=0; i<candidates.size() && !found; i++)
+				{
+					pcl::copyPointCloud(*input, candidates[i].indices, candidate);
+					found = sphereDetection(candidate, sphere, detection);
+				}
 			}
-			sphereDetection(SwissRanger_cloud);
-			cloud.cloud.header.frame_id = "/my_frame";
-			cloud.cloud.header.stamp = ros::Time::now();
-			pointCloud_pub.publish(cloud.cloud);
+			// Without candidates the whole window is searched. With them, only when no blob has the ball size: a ball
+			// touching its stand or a hand is flood filled into a larger blob, and an occluded one into a smaller blob.
+			// Out of tracking that is the whole frame, so it is then only searched every fallbackInterval frames
+			if(!found && (!blobCandidates || (candidates.empty() && (roi.valid() || ++framesWithoutFallback >= fallbackInterval))))
+			{
+				framesWithoutFallback = 0;
+				invalidDetection(detection);
+				found = sphereDetection(*input, sphere, detection);
+			}
+			publishDetection(detection);
+
+			if(found && roiMargin >= 0)
+				roi.update(*cloud.cloud, sphere, sphere[3]);
+			else
+				roi.reset();
+
+			// The raw cloud is only republished, in my_frame, when someone is listening
+			if(pointCloud_pub.getNumSubscribers() > 0)
+			{
+				sensor_msgs::PointCloud2 out = *cloud.msg;
+				out.header.frame_id = "/my_frame";
+				out.header.stamp = ros::Time::now();
+				pointCloud_pub.publish(out);
+			}
+
+			budget.finish();
+			calibration_gui::DetectionTiming timing = budget.timing();
+			timing.header.stamp = ros::Time::now();
+			timing_pub.publish(timing);
 		}
 		ros::spinOnce();
 		loop_rate.sleep();
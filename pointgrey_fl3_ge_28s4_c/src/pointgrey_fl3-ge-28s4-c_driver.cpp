@@ -26,11 +26,18 @@
  ***************************************************************************************************/
 /**
    \file  pointgrey_fl3-ge-28s4-c_driver.cpp
-   \brief Driver node for the Point Grey FL3-GE28S4-C. Sets a camera configuration, grabs the images and publishes them to a topic named RawImage.
-   Camera configuration:
-   - Resolution: 964x724 pixels
-   - Offset: x=0, y=0
-   - Mode: Mode 1
+   \brief Driver node for the Point Grey FL3-GE28S4-C. Sets a camera configuration, grabs the images and publishes them.
+   The images are always published as they come from the camera (Bayer mosaic or mono) on image_raw, and converted to
+   BGR on RawImage and to mono on image_mono only while those topics have subscribers.
+   Camera configuration (Format7), from the private parameters:
+   - mode: Format7 mode, 1 by default (2x2 binning, 964x724 pixels)
+   - width, height: image size, 0 (default) for the whole sensor from the offset
+   - offsetX, offsetY: first column and row, 0 by default
+   - pixelFormat: raw8 (default) or mono8
+   The applied window (binning, offset and size, in sensor pixels) is latched on camera_info, for the detectors to move
+   the intrinsics calibrated on another window to it. The camera matrix and distortion of that message are left empty.
+   Images are stamped with their exposure time, from the timestamp the camera embeds in them, so the detectors can
+   measure their latency from it.
    \author David Silva
    \date   August, 2016
  */
@@ -43,9 +50,12 @@
 #include <vector>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 
-#include <cv_bridge/cv_bridge.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/image_encodings.h>
 #include <image_transport/image_transport.h>
 #include <ros/package.h>
 
@@ -109,61 +119,191 @@ void PrintError( Error error )
 }
 
 /**
-@brief Configuration of the camera image format
-- Resolution: 964x724
-- Offset: x=0, y=0
-- Mode: Mode 1
-@param[in] camera
-@return false if an error occurred, true on success
-*/
-bool SetConfiguration(Camera &camera)
+   @brief ROS encoding of a RAW8 image with the Bayer pattern of the camera
+   @param[in] rawImage image retrieved from the camera
+   @return string sensor_msgs::image_encodings name, mono8 for MONO8 images and sensors without a colour filter
+ */
+string BayerEncoding( Image &rawImage )
+{
+	if(rawImage.GetPixelFormat() == PIXEL_FORMAT_MONO8)
+		return "mono8";
+
+	switch(rawImage.GetBayerTileFormat())
+	{
+		case RGGB: return "bayer_rggb8";
+		case GRBG: return "bayer_grbg8";
+		case GBRG: return "bayer_gbrg8";
+		case BGGR: return "bayer_bggr8";
+		default:   return "mono8";
+	}
+}
+
+/**
+   @brief Turns on the timestamp the camera embeds in the first pixels of each image
+   @param[in] camera
+   @return true if the camera embeds the timestamp, false if it can't
+ */
+bool EnableEmbeddedTimestamp( Camera &camera )
+{
+	EmbeddedImageInfo info;
+	Error error = camera.GetEmbeddedImageInfo(&info);
+	if(error != PGRERROR_OK || !info.timestamp.available)
+		return false;
+
+	info.timestamp.onOff = true;
+	error = camera.SetEmbeddedImageInfo(&info);
+	return error == PGRERROR_OK;
+}
+
+/**
+   \class ExposureClock
+   \brief Host time of the start of exposure of each image, from the cycle timer the camera embeds in it.
+   The cycle timer wraps every 128 s and is not synchronised with the host, so it is unwrapped and offset by the smallest
+   difference seen between reception and exposure. Stamps are then the exposure time plus the shortest transfer delay;
+   the offset grows back a little every frame to follow the drift between the clocks.
+ */
+class ExposureClock
 {
+public:
+	ExposureClock() : synced(false) {}
+
+/**
+   @brief Host time of the exposure of an image
+   @param[in] timeStamp timestamp of the image, with the embedded cycle timer
+   @param[in] received host time at which the image was retrieved
+   @return ros::Time exposure time
+ */
+	ros::Time stamp( const TimeStamp &timeStamp, const ros::Time &received )
+	{
+		double cycle = timeStamp.cycleSeconds + (timeStamp.cycleCount + timeStamp.cycleOffset/3072.0)/8000.0;
 
-    uint16_t roi_width;
-    uint16_t roi_height;
-    uint16_t roi_offset_x;
-    uint16_t roi_offset_y;
+		// a gap of half the cycle or more can't be unwrapped, so the clock starts over
+		if(!synced || (received - lastReceived).toSec() > 64)
+		{
+			start = cycle;
+			elapsed = 0;
+			offset = received.toSec() - cycle;
+			synced = true;
+		}
+		else
+		{
+			double step = cycle - lastCycle;
+			elapsed += step < -64 ? step + 128 : step;
+			offset = std::min(offset + 2e-6, received.toSec() - (start + elapsed));
+		}
 
+		lastCycle = cycle;
+		lastReceived = received;
+		return ros::Time(start + elapsed + offset);
+	}
+
+private:
+	bool synced;              /**< false until the first image, and after a gap the cycle timer can't span */
+	double start;             /**< cycle time of the first image [s] */
+	double elapsed;           /**< unwrapped cycle time since the first image [s] */
+	double offset;            /**< host clock minus unwrapped cycle time, plus the shortest transfer delay seen [s] */
+	double lastCycle;         /**< cycle time of the last image [s] */
+	ros::Time lastReceived;   /**< host time at which the last image was retrieved */
+};
+
+/**
+   @brief Sets up the message of the next frame. The buffer of the last message is reused when no subscriber holds it
+   anymore, so frames are only allocated at start up and while an intraprocess subscriber keeps the last one
+   @param[in,out] msg message of the last frame, replaced by a new one while it is still referenced elsewhere
+   @param[in] rows image height
+   @param[in] cols image width
+   @param[in] step bytes per row
+   @param[in] encoding sensor_msgs::image_encodings name
+   @return void
+ */
+void PrepareMessage( sensor_msgs::ImagePtr &msg, unsigned int rows, unsigned int cols, unsigned int step, const string &encoding )
+{
+	if(!msg || !msg.unique())
+		msg.reset(new sensor_msgs::Image);
+
+	msg->height = rows;
+	msg->width = cols;
+	msg->step = step;
+	msg->encoding = encoding;
+	msg->is_bigendian = 0;
+	msg->data.resize(rows*step);
+}
+
+/**
+@brief Rounds a Format7 size or offset down to a multiple of the step of the mode
+@param[in] value size or offset
+@param[in] step step of the mode, 0 for any value
+@return unsigned int rounded value
+*/
+unsigned int AlignToStep(unsigned int value, unsigned int step)
+{
+    return step ? value / step * step : value;
+}
+
+/**
+@brief Format7 configuration of the camera image. The size and offset are rounded down to the steps of the mode and
+clipped to the sensor
+@param[in] camera
+@param[in] mode Format7 mode
+@param[in] pixelFormat pixel format of the retrieved images
+@param[in] width image width, 0 for the whole sensor from offsetX
+@param[in] height image height, 0 for the whole sensor from offsetY
+@param[in] offsetX first column
+@param[in] offsetY first row
+@param[out] window applied window: binning of the mode, from the size of the whole sensor in mode 0, and offset and size
+in sensor pixels
+@return false if an error occurred or the camera doesn't support the settings, true on success
+*/
+bool SetConfiguration(Camera &camera, Mode mode, PixelFormat pixelFormat, unsigned int width, unsigned int height,
+                      unsigned int offsetX, unsigned int offsetY, sensor_msgs::CameraInfo &window)
+{
     // Error for checking if functions went okay
     Error error;
 
     // Get Format7 information
     Format7Info fmt7Info;
     bool supported;
-    //fmt7Info.mode = fmt7Mode;
+    fmt7Info.mode = mode;
     error = camera.GetFormat7Info(&fmt7Info, &supported);
     if ( error != PGRERROR_OK )
     {
       PrintError( error );
       return false;
     }
+    if ( !supported )
+    {
+      ROS_ERROR("Format7 mode %d is not supported by the camera", mode);
+      return false;
+    }
+    if ( !(fmt7Info.pixelFormatBitField & pixelFormat) )
+    {
+      ROS_ERROR("Pixel format 0x%x is not supported in Format7 mode %d", (unsigned int)pixelFormat, mode);
+      return false;
+    }
+
+    // Mode 0 reads out the whole sensor without binning
+    Format7Info sensorInfo;
+    sensorInfo.mode = MODE_0;
+    error = camera.GetFormat7Info(&sensorInfo, &supported);
+    if ( error != PGRERROR_OK )
+    {
+      PrintError( error );
+      return false;
+    }
 
     // Make Format7 Configuration
     Format7ImageSettings fmt7ImageSettings;
-    fmt7ImageSettings.mode = MODE_1;
-    fmt7ImageSettings.pixelFormat = PIXEL_FORMAT_RAW8;
-
-    // Check Width
-    roi_width = 964; // Locks the width into an appropriate multiple using an integer divide
-
-    fmt7ImageSettings.width = roi_width;
-
-
-    // Check Height
-    roi_height = 724; // Locks the height into an appropriate multiple using an integer divide
-
-    fmt7ImageSettings.height = roi_height;
+    fmt7ImageSettings.mode = mode;
+    fmt7ImageSettings.pixelFormat = pixelFormat;
 
+    // Offsets leave room for the smallest image, sizes are clipped to the sensor
+    fmt7ImageSettings.offsetX = AlignToStep(min<unsigned int>(offsetX, fmt7Info.maxWidth - fmt7Info.imageHStepSize), fmt7Info.offsetHStepSize);
+    fmt7ImageSettings.offsetY = AlignToStep(min<unsigned int>(offsetY, fmt7Info.maxHeight - fmt7Info.imageVStepSize), fmt7Info.offsetVStepSize);
 
-    // Check OffsetX
-    roi_offset_x = 0;  // Locks the X offset into an appropriate multiple using an integer divide
-
-    fmt7ImageSettings.offsetX  = roi_offset_x;
-
-    // Check OffsetY
-    roi_offset_y = 0;  // Locks the X offset into an appropriate multiple using an integer divide
-
-    fmt7ImageSettings.offsetY  = roi_offset_y;
+    unsigned int maxWidth = fmt7Info.maxWidth - fmt7ImageSettings.offsetX;
+    unsigned int maxHeight = fmt7Info.maxHeight - fmt7ImageSettings.offsetY;
+    fmt7ImageSettings.width = AlignToStep(width == 0 ? maxWidth : min<unsigned int>(width, maxWidth), fmt7Info.imageHStepSize);
+    fmt7ImageSettings.height = AlignToStep(height == 0 ? maxHeight : min<unsigned int>(height, maxHeight), fmt7Info.imageVStepSize);
 
     // Validate the settings to make sure that they are valid
     Format7PacketInfo fmt7PacketInfo;
@@ -174,26 +314,66 @@ bool SetConfiguration(Camera &camera)
       PrintError( error );
       return false;
     }
-
-    // Stop the camera to allow settings to change.
-    error = camera.SetFormat7Configuration(&fmt7ImageSettings, fmt7PacketInfo.recommendedBytesPerPacket);
-    if ( error != PGRERROR_OK )
+    if ( !valid )
     {
-      PrintError( error );
+      ROS_ERROR("Invalid Format7 settings: mode %d, %ux%u pixels at (%u, %u)", mode,
+                fmt7ImageSettings.width, fmt7ImageSettings.height, fmt7ImageSettings.offsetX, fmt7ImageSettings.offsetY);
       return false;
     }
 
-    // Get camera info to check if camera is running in color or mono mode
-    CameraInfo cInfo;
-    error = camera.GetCameraInfo(&cInfo);
+    // The recommended packet size gives the highest frame rate for the image size
+    error = camera.SetFormat7Configuration(&fmt7ImageSettings, fmt7PacketInfo.recommendedBytesPerPacket);
     if ( error != PGRERROR_OK )
     {
       PrintError( error );
       return false;
     }
+
+    window.header.stamp = ros::Time::now();
+    window.width = sensorInfo.maxWidth;
+    window.height = sensorInfo.maxHeight;
+    window.binning_x = max<unsigned int>(sensorInfo.maxWidth / fmt7Info.maxWidth, 1);
+    window.binning_y = max<unsigned int>(sensorInfo.maxHeight / fmt7Info.maxHeight, 1);
+    window.roi.x_offset = fmt7ImageSettings.offsetX * window.binning_x;
+    window.roi.y_offset = fmt7ImageSettings.offsetY * window.binning_y;
+    window.roi.width = fmt7ImageSettings.width * window.binning_x;
+    window.roi.height = fmt7ImageSettings.height * window.binning_y;
+
+    ROS_INFO("Format7 mode %d (%ux%u binning), %ux%u pixels at (%u, %u)", mode, window.binning_x, window.binning_y,
+             fmt7ImageSettings.width, fmt7ImageSettings.height, fmt7ImageSettings.offsetX, fmt7ImageSettings.offsetY);
 	return true;
 }
 
+/**
+   @brief Publishes a conversion of the retrieved image, written straight into the message buffer
+   @param[in] rawImage image retrieved from the camera
+   @param[in,out] msg message of the last conversion, reused while no subscriber holds it
+   @param[in] format pixel format to convert to, PIXEL_FORMAT_BGR or PIXEL_FORMAT_MONO8
+   @param[in] stamp exposure time of the image
+   @param[in] publisher
+   @return false if the conversion failed, true on success
+ */
+bool PublishConversion( Image &rawImage, sensor_msgs::ImagePtr &msg, PixelFormat format, const ros::Time &stamp,
+                        image_transport::Publisher &publisher )
+{
+	bool bgr = (format == PIXEL_FORMAT_BGR);
+	unsigned int cols = rawImage.GetCols();
+	PrepareMessage(msg, rawImage.GetRows(), cols, bgr ? 3*cols : cols,
+	               bgr ? sensor_msgs::image_encodings::BGR8 : sensor_msgs::image_encodings::MONO8);
+
+	Image converted;
+	converted.SetData(&msg->data[0], msg->data.size());
+	Error error = rawImage.Convert(format, &converted);
+	if (error != PGRERROR_OK)
+	{
+		PrintError( error );
+		return false;
+	}
+
+	msg->header.stamp = stamp;
+	publisher.publish(sensor_msgs::ImageConstPtr(msg));
+	return true;
+}
 
 /**
    @brief Driver node for the Point Grey FL3-GE28S4-C
@@ -206,16 +386,40 @@ int main(int argc, char **argv)
 	ros::init(argc, argv, "Point_Grey");
 	ros::NodeHandle n;
 	image_transport::ImageTransport it(n);
+	// the mosaic as it is, for detectors that segment it without demosaicing
+	image_transport::Publisher raw_pub = it.advertise("image_raw", 1);
+	// conversions, only made while subscribed
 	image_transport::Publisher rawImage_pub = it.advertise("RawImage", 1);
+	image_transport::Publisher mono_pub = it.advertise("image_mono", 1);
+
+	// Format7 configuration
+	int mode = 1, width = 0, height = 0, offsetX = 0, offsetY = 0;
+	string pixelFormat = "raw8";
+	ros::NodeHandle("~").getParam("mode", mode);
+	ros::NodeHandle("~").getParam("width", width);
+	ros::NodeHandle("~").getParam("height", height);
+	ros::NodeHandle("~").getParam("offsetX", offsetX);
+	ros::NodeHandle("~").getParam("offsetY", offsetY);
+	ros::NodeHandle("~").getParam("pixelFormat", pixelFormat);
+	if(mode < 0 || mode >= NUM_MODES || width < 0 || height < 0 || offsetX < 0 || offsetY < 0
+	   || (pixelFormat != "raw8" && pixelFormat != "mono8"))
+	{
+		ROS_ERROR("Invalid Format7 parameters: mode %d, %dx%d pixels at (%d, %d), pixel format %s",
+		          mode, width, height, offsetX, offsetY, pixelFormat.c_str());
+		return -1;
+	}
+	// serial number of the camera, so several cameras on the same network each get a driver; 0 for the first camera found
+	int serial = 0;
+	ros::NodeHandle("~").getParam("serial", serial);
 
-	sensor_msgs::ImagePtr image_msg;
+	sensor_msgs::ImagePtr raw_msg, bgr_msg, mono_msg;
 
 	//PointGrey
 	Error error;
 
 	BusManager busManager;
 	unsigned int numCameras=0, count=0;
-	while(numCameras!=1 && ros::ok())
+	while(numCameras==0 && ros::ok())
 	{
 		error = busManager.GetNumOfCameras(&numCameras);
 		if(error != PGRERROR_OK || count==10)
@@ -233,7 +437,10 @@ int main(int argc, char **argv)
 	Camera Camera;
 
 	PGRGuid pGuid;
-	error = busManager.GetCameraFromIndex(0,&pGuid);
+	if(serial > 0)
+		error = busManager.GetCameraFromSerialNumber(serial,&pGuid);
+	else
+		error = busManager.GetCameraFromIndex(0,&pGuid);
 	if(error != PGRERROR_OK)
 	{
 		PrintError( error );
@@ -260,7 +467,19 @@ int main(int argc, char **argv)
 
 	PrintCameraInfo(&camInfo);
 
-	SetConfiguration(Camera);
+	sensor_msgs::CameraInfo window;
+	if(!SetConfiguration(Camera, (Mode)mode, pixelFormat == "mono8" ? PIXEL_FORMAT_MONO8 : PIXEL_FORMAT_RAW8,
+	                     width, height, offsetX, offsetY, window))
+		return -1;
+	// latched, the detectors wait for it to fit their intrinsics to the window
+	ros::Publisher window_pub = n.advertise<sensor_msgs::CameraInfo>("camera_info", 1, true);
+	window_pub.publish(window);
+
+	// images are stamped with their exposure time, or with their reception time if the camera can't embed it
+	bool embeddedTimestamp = EnableEmbeddedTimestamp(Camera);
+	if(!embeddedTimestamp)
+		ROS_WARN("The camera doesn't embed timestamps, images are stamped when they are retrieved");
+	ExposureClock exposureClock;
 
 	error = Camera.StartCapture();
 	if ( error == PGRERROR_ISOCH_BANDWIDTH_EXCEEDED )
@@ -275,11 +494,8 @@ int main(int argc, char **argv)
 	}
 
 
-	Mat image1;
+	// frames are copied or converted straight into the buffers of the published messages, which are reused once released
 	Image rawImage1;
-	Image rgbImage1;
-	// capture loop
-	//ros::Rate loop_rate(15);
 	// capture loop
 	while(ros::ok())
 	{
@@ -290,32 +506,29 @@ int main(int argc, char **argv)
 		error = Camera.RetrieveBuffer( &rawImage1 );
 		if ( error != PGRERROR_OK )
 		{
-			PrintError( error );
+			ROS_WARN_THROTTLE(1, "Failed to retrieve an image: %s", error.GetDescription());
 			continue;
 		}
 
-		// convert to rgb
-		error = rawImage1.Convert(PIXEL_FORMAT_BGR, &rgbImage1 );
-		if (error != PGRERROR_OK)
-		{
-			PrintError( error );
-			return -1;
-		}
-
-		// convert to OpenCV Mat
-		unsigned int rowBytes1 = (double)rgbImage1.GetReceivedDataSize()/(double)rgbImage1.GetRows();
-		image1 = Mat(rgbImage1.GetRows(), rgbImage1.GetCols(), CV_8UC3, rgbImage1.GetData(),rowBytes1);
+		ros::Time received = ros::Time::now();
+		ros::Time stamp = embeddedTimestamp ? exposureClock.stamp(rawImage1.GetTimeStamp(), received) : received;
+		unsigned int rows = rawImage1.GetRows();
+		unsigned int cols = rawImage1.GetCols();
 
-		if(!image1.empty()) {
-			image_msg = cv_bridge::CvImage(std_msgs::Header(), "bgr8", image1).toImageMsg();
-			rawImage_pub.publish(image_msg);
-		}
-		//ros::spinOnce();
-		//loop_rate.sleep();
+		// publish the mosaic as it is, the only copy out of the FlyCapture buffer
+		PrepareMessage(raw_msg, rows, cols, cols, BayerEncoding(rawImage1));
+		for(unsigned int r = 0; r < rows; r++)
+			memcpy(&raw_msg->data[r*cols], rawImage1.GetData() + r*rawImage1.GetStride(), cols);
+		raw_msg->header.stamp = stamp;
+		raw_pub.publish(sensor_msgs::ImageConstPtr(raw_msg));
 
-		ros::Time end = ros::Time::now();
+		// debayering and mono conversion only for the topics someone listens to
+		if(rawImage_pub.getNumSubscribers() > 0 && !PublishConversion(rawImage1, bgr_msg, PIXEL_FORMAT_BGR, stamp, rawImage_pub))
+			return -1;
+		if(mono_pub.getNumSubscribers() > 0 && !PublishConversion(rawImage1, mono_msg, PIXEL_FORMAT_MONO8, stamp, mono_pub))
+			return -1;
 
-		cout << "Image getter: " <<  (end - start).toNSec() * 1e-6 << " msec"  << endl;
+		ROS_DEBUG_THROTTLE(1, "Image getter: %.3f msec", (ros::Time::now() - start).toNSec() * 1e-6);
 	}
 
 	// Stop capturing images